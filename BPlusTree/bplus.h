@@ -2,6 +2,12 @@
 #define _DARK_BPLUS_H_
 
 #include "file_manager.h"
+#include "negative_cache.h"
+#include "Dark/thread_pool"
+
+#include <memory>
+#include <initializer_list>
+#include <vector>
 
 namespace dark {
 
@@ -35,6 +41,11 @@ struct value_tuple {
     { v.copy(key,val); }
 };
 
+/* Count of tuples in a block taking page_num pages. */
+template <class key_t,class T,int page_num>
+constexpr int block_size = 
+    (page_num * 4096 - sizeof(header)) / sizeof(value_tuple <key_t,T>);
+
 /**
  * @brief A simple B+ tree implment.
  * 
@@ -47,6 +58,7 @@ struct value_tuple {
  * @tparam val_comp   Compare function for value.
  * @tparam AMORT_SIZE Threshold for amortization.(CAUTION! CAREFUL MODIFICATION!)
  * @tparam MERGE_SIZE Threshold for merging.     (CAUTION! CAREFUL MODIFICATION!)
+ * @tparam storage_t  Storage backend of the files.
  */
 template <
     class key_t,
@@ -57,7 +69,8 @@ template <
     class key_comp = Compare <key_t>,
     class val_comp = Compare   <T>,
     int AMORT_SIZE = BLOCK_SIZE * 2 / 3,
-    int MERGE_SIZE = BLOCK_SIZE / 3
+    int MERGE_SIZE = BLOCK_SIZE / 3,
+    class storage_t = file_storage
 >
 class tree {
   private: /* Struct and using part. */
@@ -84,13 +97,20 @@ class tree {
         { return set_index(index,node_type(is_inner())); }
     };
 
-    using node_file_t =
+    /* Read-only storage maps pages in place instead of caching them. */
+    using node_file_t = std::conditional_t <storage_t::read_only,
+            mapped_file_manager <
+                node,
+                ((REAL_SIZE - 1) / 4096 + 1) * 4096,
+                storage_t
+            >,
             cached_file_manager <
                 node,
                 TABLE_SIZE,
                 CACHE_SIZE,
-                ((REAL_SIZE - 1) / 4096 + 1) * 4096
-            >;
+                ((REAL_SIZE - 1) / 4096 + 1) * 4096,
+                storage_t
+            >>;
 
     using visitor = typename node_file_t::visitor;
 
@@ -103,9 +123,16 @@ class tree {
     [[no_unique_address]] key_comp k_comp; /*  Key  compare function. */
     [[no_unique_address]] val_comp v_comp; /* Value compare function. */
 
+    /* Key equality of key_comp. */
+    struct key_equal {
+        bool operator()(const key_t &x,const key_t &y) const
+        { return !key_comp()(x,y); }
+    };
+
     std::pair <file_state,node> __root_pair; /* Do not use it directly. */
     visitor cache_pointer;
     node_file_t file;
+    negative_cache <key_t,1024,8,std::hash <key_t>,key_equal> missed; /* Keys found missing. */
 
    private:
 
@@ -183,6 +210,13 @@ class tree {
     /* Allocate one node. */
     inline visitor allocate() { return file.allocate(); }
 
+    /* Mark only count and data[first,last) of an outer node modified. */
+    inline void modify_range(visitor pointer,int first,int last) {
+        pointer.modify_range(0,sizeof(header));
+        pointer.modify_range((char *)(pointer->data + first) - (char *)&*pointer,
+                             (last - first) * sizeof(tuple_t));
+    }
+
     /* Insert into an empty tree. */
     void insert_root(const key_t &key,const T &val) {
         /* Allocate one node at outer file. */
@@ -313,6 +347,18 @@ class tree {
             return;
         }
 
+        merge_son(pointer,x);
+    }
+
+
+    /**
+     * @brief Merge pointer's x-th son with its smaller brother.
+     * Note that pointer->count remains unchanged.
+     *
+     * @param pointer Pointer of father node.
+     * @param    x    The subscript of the node to merge.
+     */
+    void merge_son(visitor pointer,int x) {
         /* Merge with smaller brother. */
         bool flag = x != pointer->count - 1;
         if(flag && x != 0) 
@@ -449,7 +495,7 @@ class tree {
         if(x < 0) return false; /* Find exactly the node. */
 
         /* Data will be modified. */
-        pointer.modify();
+        modify_range(pointer,x,head.count + 1);
 
         /* Insert the key-value pair into the node. */
         mmove(pointer->data + x + 1,pointer->data + x,head.count - x);
@@ -525,7 +571,7 @@ class tree {
         if(x < 0) return false; /* Don't find exactly the node. */
 
         /* Data will be modified. */
-        pointer.modify();
+        modify_range(pointer,x,head.count - 1);
 
         /* Insert the key-value pair into the node. */
         mmove(pointer->data + x,pointer->data + x + 1,head.count - x - 1);
@@ -584,32 +630,299 @@ class tree {
     }
 
 
+    /**
+     * @brief Collect all nodes of a subtree to garbage.
+     * Only inner nodes are read , without touching the cache.
+     *
+     * @return Count of pairs in the subtree.
+     */
+    size_t discard(header head,trivial_array <int> &garbage) {
+        garbage.push_back(head.real_index());
+        if(!head.is_inner()) return head.count;
+        std::unique_ptr <node> x(new node);
+        file.read_field(x.get(),head.real_index(),0,
+                        (char *)(x->data + head.count) - (char *)x.get());
+        size_t __n = 0;
+        for(int i = 0 ; i != head.count ; ++i) __n += discard(x->head(i),garbage);
+        return __n;
+    }
+
+
+    /**
+     * @brief Erase pairs with key in [lo,hi] under an inner node.
+     * Sons inside the range are discarded whole. Only the first and the
+     * last son overlapping the range are visited , and they are dropped
+     * if left empty. Nothing is rebalanced here.
+     *
+     * @return Count of pairs erased.
+     */
+    size_t erase_range(visitor pointer,const key_t &lo,const key_t &hi,
+                       trivial_array <int> &garbage) {
+        const int count = pointer->count;
+        int l = lower_bound(pointer->data + 1,lo,0,count - 1);
+        int r = upper_bound(pointer->data,hi,0,count) - 1;
+        if(r < l) return 0;
+
+        size_t __n = 0;
+        int w = l; /* Sons kept are moved to [l,w). */
+        for(int i = l ; i <= r ; ++i) {
+            header head = pointer->head(i);
+            /* Whole son: its smallest and the next son's are in range. */
+            if(i + 1 != count && k_comp(pointer->data[i].v.key,lo) >= 0
+            && k_comp(pointer->data[i + 1].v.key,hi) <= 0) {
+                __n += discard(head,garbage);
+                continue;
+            }
+
+            visitor son = get_pointer(head);
+            if(head.is_inner()) __n += erase_range(son,lo,hi,garbage);
+            else {
+                int x = lower_bound(son->data,lo,0,head.count);
+                int y = upper_bound(son->data,hi,x,head.count);
+                if(x != y) {
+                    mmove(son->data + x,son->data + y,head.count - y);
+                    son->count -= y - x;
+                    modify_range(son,x,son->count);
+                    __n += y - x;
+                }
+            }
+
+            if(!son->count) garbage.push_back(head.real_index());
+            else {
+                pointer->data[w].v = son->data[0].v;
+                pointer->head(w)   = {head.state,son->count};
+                ++w;
+            }
+        }
+
+        mmove(pointer->data + w,pointer->data + r + 1,count - r - 1);
+        pointer->count = count - (r + 1 - w);
+        pointer.modify();
+        return __n;
+    }
+
+
+    /**
+     * @brief Fix small nodes on the path to a pair , from the top.
+     * A root with only one inner son is replaced by the son first.
+     *
+     * @return Whether anything is changed.
+     */
+    bool erase_fix(const key_t &key,const T &val) {
+        bool fixed = false;
+        while(root().count == 1 && root().head(0).is_inner()) {
+            visitor son = get_pointer(root().head(0));
+            root_state().modify();
+            root().count = son->count;
+            mmove(root().data,son->data,son->count);
+            recycle(son);
+            fixed = true;
+        }
+
+        /* Son on the path to the pair. */
+        auto locate = [&](visitor pointer) -> int {
+            int x = binary_search(pointer->data,key,val,0,pointer->count);
+            return x < 0 ? ~x : x ? x - 1 : 0;
+        };
+
+        visitor pointer = get_pointer(root());
+        visitor father  = pointer;
+        int index = -1; /* Index of pointer in father , -1 for root. */
+        while(true) {
+            int x = locate(pointer);
+            if(pointer->count > 1 && pointer->head(x).count <= MERGE_SIZE) {
+                cache_pointer = get_pointer(pointer->head(x));
+                pointer.modify();
+                if(!erase_amortize(pointer,x)) {
+                    if(index < 0 && pointer->count == 2 && cache_pointer->is_inner())
+                        merge_root(x);
+                    else merge_son(pointer,x);
+                    --pointer->count;
+                    if(index >= 0) {
+                        father.modify();
+                        father->head(index).count = pointer->count;
+                    }
+                }
+                fixed = true;
+                x = locate(pointer);
+            }
+            if(!pointer->head(x).is_inner()) return fixed;
+            father  = pointer;
+            index   = x;
+            pointer = get_pointer(pointer->head(x));
+        }
+    }
+
+
+    /**
+     * @brief Link the last leaf with a key smaller than key
+     * to the leaf after it in the tree. It is the only leaf
+     * linked to a dropped one after erase_range.
+     *
+     * @return Whether there is such a leaf.
+     */
+    bool relink(const key_t &key) {
+        if(empty() || k_comp(root().data[0].v.key,key) >= 0) return false;
+        header head = root();
+        header next = {~MAXN_SIZE,0}; /* Subtree after the leaf. */
+        while(head.is_inner()) {
+            visitor pointer = get_pointer(head);
+            int x = lower_bound(pointer->data + 1,key,0,head.count - 1);
+            if(x + 1 != head.count) next = pointer->head(x + 1);
+            head = pointer->head(x);
+        }
+        while(next.is_inner()) next = get_pointer(next)->head(0);
+
+        visitor pointer = get_pointer(head);
+        pointer->set_next(next.real_index());
+        modify_range(pointer,0,0);
+        return true;
+    }
+
+
+    /**
+     * @brief Smallest pair with a key larger than key.
+     *
+     * @return Whether there is such a pair.
+     */
+    bool upper_pair(const key_t &key,pair_t &__p) {
+        if(empty()) return false;
+        header head = root();
+        bool found = false; /* Whether __p is the smallest of a subtree after. */
+        while(head.is_inner()) {
+            visitor pointer = get_pointer(head);
+            int x = std::max(upper_bound(pointer->data,key,0,head.count) - 1,0);
+            if(x + 1 != head.count) __p = pointer->data[x + 1].v,found = true;
+            head = pointer->head(x);
+        }
+        visitor pointer = get_pointer(head);
+        int y = upper_bound(pointer->data,key,0,head.count);
+        if(y != head.count) __p = pointer->data[y].v,found = true;
+        return found;
+    }
+
+
+    /**
+     * @brief Visit all pairs in the subtree in order , reading
+     * nodes into buf[depth ...] without touching the cache.
+     */
+    template <class func_t>
+    void scan(header head,size_t depth,
+              std::vector <std::unique_ptr <node>> &buf,func_t &&func) {
+        if(buf.size() == depth) buf.emplace_back(new node);
+        node &x = *buf[depth];
+        file.read_object(x,head.real_index());
+        if(!head.is_inner()) {
+            for(int i = 0 ; i != x.count ; ++i) func(x.data[i].v);
+            return;
+        }
+        for(int i = 0 ; i != x.count ; ++i) file.prefetch(x.head(i).real_index());
+        for(int i = 0 ; i != x.count ; ++i) scan(x.head(i),depth + 1,buf,func);
+    }
+
+
+    /* Count pairs of key in the subtree. */
+    size_t count(header head,const key_t &key) {
+        visitor pointer = get_pointer(head);
+        if(!head.is_inner()) {
+            int x = lower_bound(pointer->data,key,0,head.count);
+            return upper_bound(pointer->data,key,x,head.count) - x;
+        }
+        int x = lower_bound(pointer->data + 1,key,0,head.count - 1);
+        size_t __n = 0;
+        for(int i = x ; i != head.count ; ++i) {
+            if(i != x && k_comp(key,pointer->data[i].v.key)) break;
+            /* Whole leaf of key: both its smallest and the next are key. */
+            if(i != x && i + 1 != head.count && !pointer->head(i).is_inner()
+            && !k_comp(key,pointer->data[i + 1].v.key))
+                __n += pointer->head(i).count;
+            else __n += count(pointer->head(i),key);
+        } return __n;
+    }
+
+
+    /**
+     * @brief Append values of key satisfying func to v.
+     * 
+     * @return Whether any pair of key exists.
+     */
+    template <class list_t,class __C>
+    bool collect(const key_t &key,list_t &v,__C &&func) {
+        header head = root();
+        /* Find the real inner node. */
+        while(head.is_inner()) {
+            visitor pointer = get_pointer(head);
+            int x = lower_bound(pointer->data + 1,key,0,head.count - 1);
+            head = pointer->head(x);
+        }
+        /* The real outer node. */
+        visitor pointer = get_pointer(head);
+        int x = lower_bound(pointer->data,key,0,head.count);
+        bool found = false;
+
+        /* Find in the first block. */
+        while(x != head.count) {
+            if(k_comp(key,pointer->data[x].v.key)) return found;
+            const T &val = pointer->data[x++].v.val;
+            if(func(val)) v.copy_back(val);
+            found = true;
+        }
+
+        /* Find in the second block. */
+        while(pointer->next() != MAXN_SIZE) {
+            pointer = get_pointer(*pointer); x = 0;
+            while(x != pointer->count) {
+                if(k_comp(key,pointer->data[x].v.key)) return found;
+                const T &val = pointer->data[x++].v.val;
+                if(func(val)) v.copy_back(val);
+                found = true;
+            }
+        } return found;
+    }
+
+
   public: /* Public functions. */
 
-    using return_list = dark::trivial_array <T>;
+    /* Whether the tree is opened read-only. */
+    static constexpr bool read_only = storage_t::read_only;
+
+    using key_type    = key_t;
+    using mapped_type = T;
+    using return_list = dark::trivial_array <T,tagged_allocator <T,tag::result_list>>;
 
 
     /* No default constructor. */
     tree() = delete;
 
 
-    /* Initialize the tree. */
+    /* Initialize the tree. Pages hot at last shutdown are loaded first. */
     tree(std::string path1) :
-        file(path1 + ".dat",path1 + ".bin") {
+        file(path1 + ".dat",path1 + ".bin",path1 + ".hot") {
         if(file.empty()) {
-            file.init();
-            root_state().modify();
+            if constexpr (!read_only) {
+                file.init();
+                root_state().modify();
+            }
             root().set_index(0,node_type::INNER);
             root().count = 0;
         } else {
             file.read_object(root(),0);
             root_state().state = false;
+            file.load_hot();
         }
     }
 
 
     /* Update root info if modified. */
-    ~tree() { if(root_state().is_modified()) file.write_object(root(),0); }
+    ~tree() {
+        save_hot();
+        if constexpr (!read_only)
+            if(root_state().is_modified()) file.write_object(root(),0);
+    }
+
+
+    /* Save the hot page list. Inner nodes come before leaves. */
+    void save_hot() { file.save_hot([](const node &x) { return !x.is_inner(); }); }
 
 
     /* Return whether the tree is empty. */
@@ -618,6 +931,9 @@ class tree {
     /* Return count of all space occupied. */
     size_t size() const noexcept { return file.size(); }
 
+    /* Storage of the node file. */
+    storage_t &storage() noexcept { return file.storage(); }
+
 
     /**
      * @brief Insert a key-value pair into the node.
@@ -627,6 +943,8 @@ class tree {
      * @return Whether the insertion is successful.
      */
     void insert(const key_t &key,const T &val) {
+        static_assert(!read_only,"Read-only tree can't be modified!");
+        missed.erase(key);
         /* Empty Tree special case. */
         if(empty()) return insert_root(key,val);
 
@@ -643,72 +961,302 @@ class tree {
      * @return Whether the erasion is successful.
      */    
     void erase(const key_t &key,const T &val) {
+        static_assert(!read_only,"Read-only tree can't be modified!");
         if(!empty()) erase(root(),key,val);
     }
 
 
-    /* Find all value-type binded to key. */
-    void find(const key_t &key,return_list &v) {
-        if(empty()) return;
-        header head = root();
-        /* Find the real inner node. */
-        while(head.is_inner()) {
+    /**
+     * @brief Erase all pairs with key in [lo,hi].
+     * Subtrees inside the range are dropped whole , and their pages
+     * are recycled together at the end. Only the nodes holding the
+     * pairs just before and after the range are visited and rebalanced.
+     *
+     * @return Count of pairs erased.
+     */
+    size_t erase_range(const key_t &lo,const key_t &hi) {
+        static_assert(!read_only,"Read-only tree can't be modified!");
+        if(empty() || k_comp(lo,hi) > 0) return 0;
+        trivial_array <int> garbage;
+        size_t __n = erase_range(get_pointer(root()),lo,hi,garbage);
+        if(!__n) return 0;
+        relink(lo);
+
+        /* Pairs around the range , on whose paths nodes may be small. */
+        pair_t bound[2];
+        int count = 0;
+        if(!empty() && k_comp(root().data[0].v.key,lo) < 0) {
+            header head = root();
+            while(head.is_inner()) {
+                visitor pointer = get_pointer(head);
+                head = pointer->head(lower_bound(pointer->data + 1,lo,0,head.count - 1));
+            }
             visitor pointer = get_pointer(head);
-            int x = lower_bound(pointer->data + 1,key,0,head.count - 1);
-            head = pointer->head(x);
+            bound[count++] = pointer->data[lower_bound(pointer->data,lo,0,head.count) - 1].v;
         }
-        /* The real outer node. */
-        visitor pointer = get_pointer(head);
-        int x = lower_bound(pointer->data,key,0,head.count);
-        /* Find in the first block. */
-        while(x != head.count) {
-            if(k_comp(key,pointer->data[x].v.key)) return;
-            v.copy_back(pointer->data[x++].v.val);
+        if(upper_pair(hi,bound[count])) ++count;
+
+        for(bool fixed = true ; fixed ;) {
+            fixed = false;
+            for(int i = 0 ; i != count ; ++i)
+                fixed |= erase_fix(bound[i].key,bound[i].val);
         }
-        /* Find in the second block. */
-        while(pointer->next() != MAXN_SIZE) {
-            pointer = get_pointer(*pointer); x = 0;
-            while(x != pointer->count) {
-                if(k_comp(key,pointer->data[x].v.key)) return;
-                v.copy_back(pointer->data[x++].v.val);
+        file.recycle(garbage.data(),garbage.data() + garbage.size());
+        return __n;
+    }
+
+
+    /**
+     * @brief Erase all pairs of key. The key is then known missing.
+     *
+     * @return Count of pairs erased.
+     */
+    size_t erase_all(const key_t &key) {
+        size_t __n = erase_range(key,key);
+        if(!missed.contains(key)) missed.insert(key);
+        return __n;
+    }
+
+
+    /**
+     * @brief Build an empty tree from sorted pairs in parallel.
+     * The shape is fixed up front: leaves are filled to about AMORT_SIZE,
+     * every level takes a contiguous page range , and each node knows
+     * its pages and children. Since the smallest pair of a subtree is
+     * the first pair of its first leaf , every node of every level is
+     * built from the input alone. Threads take contiguous page ranges
+     * and write them directly , bypassing the cache. The leaf chain
+     * follows page order , so only the root is left to fill.
+     * 
+     * @param data  Pairs sorted by (key,val) without duplicates.
+     * @param count Count of pairs.
+     * @param pool  Thread pool to build on.
+     * @return Whether loaded. False if the tree is not empty.
+     */
+    bool bulk_load(const pair_t *data,size_t count,
+                   thread_pool &pool = thread_pool::global()) {
+        static_assert(!read_only,"Read-only tree can't be modified!");
+        if(!empty()) return false;
+        if(!count)   return true;
+        missed.clear();
+
+        /**
+         * bound[k][j] : First child of node j at level k.
+         *               For leaves (k = 0) , first pair instead.
+         * first[k][j] : First pair under node j at level k.
+         */
+        std::vector <trivial_array <size_t>> bound,first;
+        std::vector <int> base; /* First page of each level. */
+        size_t total = 0,below = count;
+        do {
+            size_t __n = (below + AMORT_SIZE - 1) / AMORT_SIZE;
+            trivial_array <size_t> __b(__n + 1),__f(__n);
+            __b.resize(__n + 1);
+            __f.resize(__n);
+            for(size_t j = 0 ; j <= __n ; ++j) __b[j] = j * below / __n;
+            for(size_t j = 0 ; j != __n ; ++j)
+                __f[j] = bound.empty() ? __b[j] : first.back()[__b[j]];
+            bound.push_back(std::move(__b));
+            first.push_back(std::move(__f));
+            total += __n;
+            below  = __n;
+        } while(below > BLOCK_SIZE);
+
+        int page = file.allocate_range(total);
+        for(auto &&__b : bound) base.push_back(page),page += __b.size() - 1;
+
+        /* Header of node j at level k , as seen by its parent. */
+        auto child = [&](size_t k,size_t j) -> header {
+            header __h;
+            __h.set_index(base[k] + j,k ? node_type::INNER : node_type::OUTER);
+            __h.count = bound[k][j + 1] - bound[k][j];
+            return __h;
+        };
+
+        /* Pages are numbered level by level , as allocated. */
+        pool.parallel_for(0,total,[&](size_t lo,size_t hi) {
+            std::unique_ptr <node> buf(new node);
+            memset((void *)buf.get(),0,sizeof(node));
+            size_t k = 0;
+            for(; lo != hi ; ++lo) {
+                while(lo >= base[k] - base[0] + bound[k].size() - 1) ++k;
+                size_t j    = lo - (base[k] - base[0]);
+                size_t __n  = bound[k].size() - 1;
+                size_t next = j + 1 != __n ? base[k] + j + 1 : MAXN_SIZE;
+                buf->count  = bound[k][j + 1] - bound[k][j];
+                if(!k) {
+                    buf->set_next(next,node_type::OUTER);
+                    for(int i = 0 ; i != buf->count ; ++i) {
+                        const pair_t &__p = data[bound[0][j] + i];
+                        buf->data[i].copy(__p.key,__p.val);
+                    }
+                } else {
+                    buf->set_next(next,node_type::INNER);
+                    for(int i = 0 ; i != buf->count ; ++i) {
+                        size_t c = bound[k][j] + i;
+                        buf->data[i].copy(data[first[k - 1][c]],child(k - 1,c));
+                    }
+                }
+                file.write_object(*buf,base[k] + j);
+            }
+        },std::max <size_t> (1,total / (pool.size() * 4)));
+
+        /* Children of the root are the top level. */
+        size_t k = bound.size() - 1;
+        root_state().modify();
+        root().count = bound[k].size() - 1;
+        for(int j = 0 ; j != root().count ; ++j)
+            root().data[j].copy(data[first[k][j]],child(k,j));
+        return true;
+    }
+
+
+    /* Write all modified nodes to disk. */
+    void flush() {
+        if constexpr (!read_only) {
+            file.flush();
+            if(root_state().is_modified()) {
+                file.write_object(root(),0);
+                root_state().state = false;
             }
         }
     }
 
 
+    /**
+     * @brief Fold all pairs in parallel , merging partial results in key order.
+     * The key space is split into subtrees under the root's children
+     * (or grandchildren , if those are inner). Each worker reads its
+     * subtrees with local buffers , straight from storage , and asks
+     * for the children of an inner node ahead before visiting them.
+     * The tree must not be modified during the fold.
+     * 
+     * @param init  Initial value of every partial result.
+     * @param fold  fold(acc_t &,const pair_t &) adds a pair to a partial result.
+     * @param merge merge(acc_t &lhs,acc_t &&rhs) appends rhs , which follows lhs in key order.
+     * @param pool  Thread pool to scan on.
+     * @return Result of all pairs.
+     */
+    template <class acc_t,class fold_func,class merge_func>
+    acc_t parallel_fold(acc_t init,fold_func &&fold,merge_func &&merge,
+                        thread_pool &pool = thread_pool::global()) {
+        if(empty()) return init;
+        flush(); /* Workers read storage , not the cache. */
+
+        trivial_array <header> part;
+        {
+            std::unique_ptr <node> buf(new node);
+            for(int i = 0 ; i != root().count ; ++i) {
+                header head = root().head(i);
+                if(!head.is_inner()) { part.push_back(head); continue; }
+                file.read_object(*buf,head.real_index());
+                for(int j = 0 ; j != buf->count ; ++j) part.push_back(buf->head(j));
+            }
+        }
+
+        std::vector <acc_t> result(part.size(),init);
+        pool.parallel_for(0,part.size(),[&](size_t lo,size_t hi) {
+            std::vector <std::unique_ptr <node>> buf; /* One per depth. */
+            for(; lo != hi ; ++lo) scan(part[lo],0,buf,[&](const pair_t &__p) {
+                fold(result[lo],__p);
+            });
+        },1);
+
+        acc_t ans = std::move(result[0]);
+        for(size_t i = 1 ; i != result.size() ; ++i) merge(ans,std::move(result[i]));
+        return ans;
+    }
+
+
+    /**
+     * @brief Call func(const pair_t &) on all pairs in parallel.
+     * Pairs in one subtree are visited in order by one thread ,
+     * but different subtrees run concurrently in any order.
+     * The tree must not be modified during the scan.
+     */
+    template <class func_t>
+    void parallel_scan(func_t &&func,thread_pool &pool = thread_pool::global()) {
+        struct none {};
+        parallel_fold(none {},[&](none &,const pair_t &__p) { func(__p); },
+                      [](none &,none &&) {},pool);
+    }
+
+
+    /* Find all value-type binded to key. */
+    void find(const key_t &key,return_list &v)
+    { find_if(key,v,[](const T &) { return true; }); }
+
+
     /* Find all value-type binded to key if satisfying compare function. */
     template <class __C>
     void find_if(const key_t &key,return_list &v,__C &&func) {
-        if(empty()) return;
+        if(empty() || missed.contains(key)) return;
+        if(!collect(key,v,func)) missed.insert(key);
+    }
+
+    /**
+     * @brief Count all pairs of key.
+     * Leaves inside a run of key are counted by their header
+     * in the parent , without being read.
+     */
+    size_t count(const key_t &key) {
+        if(empty() || missed.contains(key)) return 0;
+        size_t __n = count(root(),key);
+        if(!__n) missed.insert(key);
+        return __n;
+    }
+
+
+    /* Whether any pair of key exists. */
+    bool contains(const key_t &key) { T val; return first(key,val); }
+
+
+    /* Whether the pair exists. Stops at the inner node holding it if any. */
+    bool contains(const key_t &key,const T &val) {
+        if(empty() || missed.contains(key)) return false;
+        header head = root();
+        while(head.is_inner()) {
+            visitor pointer = get_pointer(head);
+            int x = binary_search(pointer->data,key,val,0,head.count);
+            if(x < 0)  return true;  /* Smallest pair of a child. */
+            if(x == 0) return false; /* Smaller than the smallest. */
+            head = pointer->head(x - 1);
+        }
+        visitor pointer = get_pointer(head);
+        return binary_search(pointer->data,key,val,0,head.count) < 0;
+    }
+
+
+    /**
+     * @brief Find the smallest value of key.
+     * 
+     * @param key Key to find.
+     * @param val Set to the value if found.
+     * @return Whether any pair of key exists.
+     */
+    bool first(const key_t &key,T &val) {
+        if(empty() || missed.contains(key)) return false;
         header head = root();
-        /* Find the real inner node. */
         while(head.is_inner()) {
             visitor pointer = get_pointer(head);
             int x = lower_bound(pointer->data + 1,key,0,head.count - 1);
             head = pointer->head(x);
         }
-        /* The real outer node. */
         visitor pointer = get_pointer(head);
         int x = lower_bound(pointer->data,key,0,head.count);
-
-        /* Find in the first block. */
-        while(x != head.count) {
-            if(k_comp(key,pointer->data[x].v.key)) return;
-            const T &val = pointer->data[x++].v.val;
-            if(func(val)) v.copy_back(val);
-        }
-
-        /* Find in the second block. */
-        while(pointer->next() != MAXN_SIZE) {
+        /* The first pair of key may start the next block. */
+        if(x == head.count && pointer->next() != MAXN_SIZE) {
             pointer = get_pointer(*pointer); x = 0;
-            while(x != pointer->count) {
-                if(k_comp(key,pointer->data[x].v.key)) return;
-                const T &val = pointer->data[x++].v.val;
-                if(func(val)) v.copy_back(val);
-            }
         }
+        if(x == pointer->count || k_comp(key,pointer->data[x].v.key)) {
+            missed.insert(key);
+            return false;
+        }
+        val = pointer->data[x].v.val;
+        return true;
     }
 
+
     struct iterator;
     friend class iterator;
     /* Custom iterator. Be careful when modifing. */
@@ -751,6 +1299,202 @@ class tree {
         return temp;
     }
 
+    /**
+     * @brief Cursor over values of one key in ascending order.
+     * It streams the run of key leaf by leaf. Values of the current
+     * leaf are copied out , so cursors stay valid while the cache
+     * changes under them , but not while the tree is modified.
+     */
+    class cursor {
+      private:
+        friend class tree;
+        tree  *__t;
+        key_t  key;
+        header next_head; /* Leaf after the buffered one if the run goes on. */
+        bool   has_next;
+        int    pos,count;
+        T      buf[BLOCK_SIZE];
+
+        /* Buffer the run of key in a leaf from index x. */
+        void load(visitor pointer,int x) {
+            pos = count = 0;
+            while(x != pointer->count && !__t->k_comp(key,pointer->data[x].v.key))
+                buf[count++] = pointer->data[x++].v.val;
+            has_next  = x == pointer->count && pointer->next() != MAXN_SIZE;
+            next_head = *pointer;
+        }
+
+        /* Buffer the next leaf. Skip empty leaves. */
+        void load_next() {
+            do load(__t->get_pointer(next_head),0);
+            while(!count && has_next);
+        }
+
+        /* Descend to the first pair no smaller than (key,val). */
+        void descend(const T &val) {
+            header head = __t->root();
+            while(head.is_inner()) {
+                visitor pointer = __t->get_pointer(head);
+                int x = __t->binary_search(pointer->data,key,val,0,head.count);
+                if(x < 0) x = ~x;
+                else if(x > 0) --x;
+                head = pointer->head(x);
+            }
+            visitor pointer = __t->get_pointer(head);
+            int x = __t->binary_search(pointer->data,key,val,0,head.count);
+            load(pointer,x < 0 ? ~x : x);
+            /* The run may start at the next leaf. */
+            if(!count && has_next) load_next();
+        }
+
+        /* Start at the first value of key in tree t. */
+        void start(tree *t,const key_t &k) {
+            __t = t;
+            key = k;
+            pos = count = 0;
+            has_next = false;
+            if(__t->empty() || __t->missed.contains(key)) return;
+            header head = __t->root();
+            while(head.is_inner()) {
+                visitor pointer = __t->get_pointer(head);
+                int x = __t->lower_bound(pointer->data + 1,key,0,head.count - 1);
+                head = pointer->head(x);
+            }
+            visitor pointer = __t->get_pointer(head);
+            load(pointer,__t->lower_bound(pointer->data,key,0,head.count));
+            /* The run may start at the next leaf. */
+            if(!count && has_next) load_next();
+        }
+
+      public:
+
+        /* Whether at a value. */
+        bool valid() const noexcept { return pos != count; }
+
+        /* Current value. */
+        const T &operator * (void) const noexcept { return buf[pos]; }
+
+        /* Move to the next value. */
+        cursor &operator ++(void) {
+            if(++pos == count && has_next) load_next();
+            return *this;
+        }
+
+        /**
+         * @brief Move to the first value no smaller than val.
+         * Galloping in the buffered leaf , and descend again
+         * from the root if val lies beyond it.
+         * 
+         * @return Whether at a value.
+         */
+        bool seek(const T &val) {
+            if(!valid() || __t->v_comp(buf[pos],val) >= 0) return valid();
+            if(__t->v_comp(buf[count - 1],val) < 0) {
+                if(has_next) descend(val);
+                else pos = count;
+                return valid();
+            }
+            int step = 1,lo = pos;
+            while(pos + step < count && __t->v_comp(buf[pos + step],val) < 0)
+                lo = pos + step,step <<= 1;
+            int hi = std::min(pos + step,count - 1);
+            while(lo != hi) { /* buf[lo] < val <= buf[hi] */
+                int mid = (lo + hi) >> 1;
+                if(__t->v_comp(buf[mid],val) < 0) lo = mid + 1;
+                else hi = mid;
+            } pos = lo;
+            return true;
+        }
+    };
+
+
+    /* Cursor at the first value of key. */
+    cursor find_cursor(const key_t &key) {
+        cursor __c;
+        __c.start(this,key);
+        return __c;
+    }
+
+
+    /**
+     * @brief Call func(value) for each value under all of keys , ascending.
+     * Cursors of the keys leapfrog each other: each one seeks the
+     * largest value seen so far , galloping over values between.
+     */
+    template <class func_t>
+    void intersect(std::initializer_list <key_t> keys,func_t &&func) {
+        const size_t __n = keys.size();
+        if(!__n) return;
+        std::unique_ptr <cursor[]> __c(new cursor[__n]);
+        for(size_t i = 0 ; i != __n ; ++i) {
+            __c[i].start(this,keys.begin()[i]);
+            if(!__c[i].valid()) return;
+        }
+
+        T x = *__c[0];
+        size_t same = 1; /* Cursors at x. */
+        for(size_t i = 1 % __n ;; i = (i + 1) % __n) {
+            if(same == __n) {
+                func(x);
+                if(!(++__c[i]).valid()) return;
+                x = *__c[i];
+                same = 1;
+            } else if(!__c[i].seek(x)) return;
+            else if(v_comp(*__c[i],x)) x = *__c[i],same = 1;
+            else ++same;
+        }
+    }
+
+
+    /**
+     * @brief Call func(value) for each value under any of keys , ascending ,
+     * each value once. Cursors of the keys are merged by the smallest.
+     */
+    template <class func_t>
+    void unite(std::initializer_list <key_t> keys,func_t &&func) {
+        const size_t __n = keys.size();
+        std::unique_ptr <cursor[]> __c(new cursor[__n]);
+        for(size_t i = 0 ; i != __n ; ++i) __c[i].start(this,keys.begin()[i]);
+
+        while(true) {
+            const T *x = nullptr;
+            for(size_t i = 0 ; i != __n ; ++i)
+                if(__c[i].valid() && (!x || v_comp(*__c[i],*x) < 0)) x = &*__c[i];
+            if(!x) return;
+            const T val = *x;
+            func(val);
+            for(size_t i = 0 ; i != __n ; ++i)
+                if(__c[i].valid() && !v_comp(*__c[i],val)) ++__c[i];
+        }
+    }
+
+
+    /**
+     * @brief Call func(value) for each value under a but not under b ,
+     * ascending. The cursor of b seeks each value of a.
+     */
+    template <class func_t>
+    void subtract(const key_t &a,const key_t &b,func_t &&func) {
+        cursor x = find_cursor(a);
+        if(!x.valid()) return;
+        cursor y = find_cursor(b);
+        for(; x.valid() ; ++x)
+            if(!y.seek(*x) || v_comp(*y,*x)) func(*x);
+    }
+
+
+    /* Append values under all of keys to v , ascending. */
+    void intersect(std::initializer_list <key_t> keys,return_list &v)
+    { intersect(keys,[&v](const T &x) { v.push_back(x); }); }
+
+    /* Append values under any of keys to v , ascending. */
+    void unite(std::initializer_list <key_t> keys,return_list &v)
+    { unite(keys,[&v](const T &x) { v.push_back(x); }); }
+
+    /* Append values under a but not under b to v , ascending. */
+    void subtract(const key_t &a,const key_t &b,return_list &v)
+    { subtract(a,b,[&v](const T &x) { v.push_back(x); }); }
+
     // /* Find reference to data , only when there exists only one value tied to key. */
     // T *get_reference(const key_t &key) {
     //     if(empty()) return nullptr;
@@ -782,14 +1526,27 @@ class tree {
  * @tparam TABLE_SIZE Length of hast_table.
  * @tparam CACHE_SIZE Count of node in cache pool (NO LESS THAN 3 * tree_height).
  * @tparam page_num   Pages that one block takes.
+ * @tparam storage_t  Storage backend of the files.
  */
-template <class key_t,class T,int TABLE_SIZE,int CACHE_SIZE,int page_num>
+template <
+    class key_t,
+    class T,
+    int TABLE_SIZE,
+    int CACHE_SIZE,
+    int page_num,
+    class storage_t = file_storage
+>
 using bpt = b_plus::tree <
     key_t,
       T,
     TABLE_SIZE,
     CACHE_SIZE,
-    (page_num * 4096 - sizeof(header)) / sizeof(b_plus::value_tuple <key_t,T>)
+    b_plus::block_size <key_t,T,page_num>,
+    Compare <key_t>,
+    Compare   <T>,
+    b_plus::block_size <key_t,T,page_num> * 2 / 3,
+    b_plus::block_size <key_t,T,page_num> / 3,
+    storage_t
 >;
 
 
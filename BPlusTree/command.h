@@ -0,0 +1,98 @@
+#ifndef _DARK_COMMAND_H_
+#define _DARK_COMMAND_H_
+
+#include "Dark/inout"
+
+#include <cstdlib>
+#include <charconv>
+
+namespace dark {
+
+/* Hash a key string into a tree key. */
+size_t hash_str(const char *str) {
+    static size_t fix_random = rand() * rand();
+    size_t __h = fix_random;
+    while(*str) { __h = __h * 137 + *(str++); }
+    return __h;
+}
+
+
+/**
+ * @brief Run one command on the tree.
+ * A read-only tree ignores insert and delete.
+ *
+ * @param t    The tree.
+ * @param op   First char of the command. ('i'nsert / 'd'elete / 'f'ind)
+ * @param key  Key string of the command.
+ * @param val  Value of insert / delete. Ignored by find.
+ * @param data Buffer for find result.
+ * @return Whether it is a find , whose result is in data.
+ */
+template <class tree_t>
+bool execute_command(tree_t &t,char op,const char *key,int val,
+                     typename tree_t::return_list &data) {
+    if(op == 'i' || op == 'd') {
+        if constexpr (!tree_t::read_only) {
+            if(op == 'i') t.insert(hash_str(key),val);
+            else          t.erase (hash_str(key),val);
+        } return false;
+    } else {
+        data.clear();
+        t.find(hash_str(key),data);
+        return true;
+    }
+}
+
+
+/* Append the result of find in [first,last) to a char buffer. */
+template <class value_t,class buffer_t>
+void format_result(const value_t *first,const value_t *last,buffer_t &buf) {
+    if(first == last) {
+        for(const char *__s = "null" ; *__s ; ++__s) buf.push_back(*__s);
+    } else {
+        char __c[24];
+        for(; first != last ; ++first) {
+            char *__e = std::to_chars(__c,__c + sizeof(__c),*first).ptr;
+            for(char *__p = __c ; __p != __e ; ++__p) buf.push_back(*__p);
+            buf.push_back(' ');
+        }
+    } buf.push_back('\n');
+}
+
+
+/**
+ * @brief Append the result of find to a char buffer,
+ * in exactly the format run_command prints.
+ *
+ * @param data Result of find.
+ * @param buf  Buffer with push_back(char).
+ */
+template <class list_t,class buffer_t>
+void format_result(const list_t &data,buffer_t &buf)
+{ format_result(data.data(),data.data() + data.size(),buf); }
+
+
+/**
+ * @brief Run one command on the tree and print the result of find.
+ * A read-only tree ignores insert and delete.
+ *
+ * @param t    The tree.
+ * @param op   First char of the command. ('i'nsert / 'd'elete / 'f'ind)
+ * @param key  Key string of the command.
+ * @param val  Value of insert / delete. Ignored by find.
+ * @param data Buffer for find result.
+ */
+template <class tree_t>
+void run_command(tree_t &t,char op,const char *key,int val,
+                 typename tree_t::return_list &data) {
+    if(!execute_command(t,op,key,val,data)) return;
+    if(data.empty()) puts("null");
+    else {
+        for(auto iter : data) dark::print(iter,' ');
+        putchar('\n');
+    }
+}
+
+}
+
+#endif
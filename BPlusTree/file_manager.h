@@ -4,6 +4,8 @@
 #include "rubbish_bin.h"
 #include "Dark/LRU_map"
 
+#include <algorithm>
+
 namespace dark {
 
 
@@ -14,25 +16,41 @@ namespace dark {
  * @tparam table_size Table size of inner LRU_map.
  * @tparam cache_size Cache size of inner LRU_map.
  * @tparam page_size Size of a page for writing.
+ * @tparam storage_t Storage backend of the files.
  */
 template <
     class T,
     size_t table_size,
     size_t cache_size,
-    size_t page_size = ((sizeof(T) - 1) / 4096 + 1) * 4096
+    size_t page_size = ((sizeof(T) - 1) / 4096 + 1) * 4096,
+    class storage_t  = file_storage
 >
 class cached_file_manager {
   public:
     struct visitor; /* Declaration. */
 
   private:
-    using map_t    = linked_hash_map <file_state,T,table_size>;
+    using map_t    = linked_hash_map <file_state,T,table_size,
+        std::hash <file_state>,std::equal_to <file_state>,
+        tagged_allocator <std::pair <file_state,T>,tag::buffer_pool>>;
     using iterator = typename map_t::iterator;
 
-    rubbish_bin  bin;      /* Rubbish bin. */
-    std::fstream dat_file; /* Pure data file. */
-    map_t map;             /* Map of cache.   */
-    T cache;               /* Cache Block.    */
+    /* Bytes moved per page. The tail of T beyond a page is never stored. */
+    static constexpr size_t io_size = sizeof(T) < page_size ? sizeof(T) : page_size;
+
+    /* Unit of partial write back. A page has at most 64 sectors. */
+    static constexpr size_t sector_size = std::max <size_t> (512,(page_size + 63) / 64);
+
+    /* Pages between two hot pages read through in one request. */
+    static constexpr size_t kHOLE = 4;
+    /* Maximum pages spanned by one warm-up request. */
+    static constexpr size_t kSPAN = 64;
+
+    rubbish_bin <storage_t> bin; /* Rubbish bin. */
+    storage_t dat_file;          /* Pure data file. */
+    std::string hot_path;        /* Path of hot page list. */
+    map_t map;                   /* Map of cache.   */
+    T cache;                     /* Cache Block.    */
 
     /* Insert the map with data in cache block at given iterator. */
     visitor insert_map(file_state state) {
@@ -40,8 +58,7 @@ class cached_file_manager {
         if(map.size() == cache_size) {
             auto *__t = map.last();
             /* If modified , write to disk first. */
-            if(__t->first.is_modified())
-                write_object(__t->second,__t->first.index);
+            if(__t->first.is_modified()) write_back(__t->first,__t->second);
             map.erase(__t->first); /* Erase it! */
         }
 
@@ -49,6 +66,22 @@ class cached_file_manager {
         return {map.insert(state,cache,state.state).next_data()};
     }
 
+    /* Write back a modified page. Only dirty sectors if partly modified. */
+    void write_back(const file_state &state,const T &obj) {
+        if(!state.dirty) return write_object(obj,state.index);
+        const char *__p = (const char *)&obj;
+        const size_t base = size_t(state.index) * page_size;
+        uint64_t mask = state.dirty;
+        while(mask) { /* One write per run of dirty sectors. */
+            size_t lo = __builtin_ctzll(mask),hi = lo;
+            while(hi != 64 && (mask >> hi & 1)) ++hi;
+            mask = hi == 64 ? 0 : mask & (~0ull << hi);
+            size_t first = lo * sector_size;
+            size_t last  = std::min(hi * sector_size,io_size);
+            if(first < last) dat_file.write(__p + first,base + first,last - first);
+        }
+    }
+
   public:
     /* Visitor to cache data. */
     struct visitor {
@@ -59,6 +92,14 @@ class cached_file_manager {
         /* Use this function whenever the state is modified. */
         inline void modify() noexcept { return __p->first.modify(); }
 
+        /* Use this instead if only [offset,offset + length) is modified. */
+        inline void modify_range(size_t offset,size_t length) noexcept {
+            if(!length) return;
+            size_t lo = std::min <size_t> (offset / sector_size,63);
+            size_t hi = std::min <size_t> ((offset + length - 1) / sector_size,63);
+            __p->first.modify((hi == 63 ? ~0ull : (2ull << hi) - 1) & (~0ull << lo));
+        }
+
         /* Customly modify the data by passing function and args. */
         template <class modify_func,class ...Args>
         inline void modify(modify_func &&__f,Args &&...objs) noexcept
@@ -86,21 +127,16 @@ class cached_file_manager {
      * 
      * @param __dat The path for .dat file.
      * @param __bin The path for .bin file.
+     * @param __hot The path for .hot file. Empty if no warm-up.
      */
-    cached_file_manager(std::string __dat,std::string __bin) noexcept :
-        bin(__bin), dat_file(__dat,std::ios::in | std::ios::out | std::ios::binary)  {
-        if(!dat_file.good()) {
-            dat_file.close(); dat_file.open(__dat,std::ios::out);
-            dat_file.close(); dat_file.open(__dat,std::ios::in | std::ios::out | std::ios::binary);
-        }
-    }
+    cached_file_manager(std::string __dat,std::string __bin,std::string __hot = "")
+    noexcept : bin(__bin),hot_path(std::move(__hot)) { dat_file.open(__dat); }
 
     /* Write out information. */
     ~cached_file_manager() {
         /* Write cache info from data to disk*/
         for(auto &&iter : map) {
-            if(iter.first.is_modified())
-                write_object(iter.second,iter.first.index);
+            if(iter.first.is_modified()) write_back(iter.first,iter.second);
         }
     }
 
@@ -115,22 +151,155 @@ class cached_file_manager {
     /* Recycle an old node. */
     void recycle(int index) { bin.recycle(index); map.erase({index,0}); }
 
+    /* Recycle old nodes in [first,last) at once. */
+    void recycle(const int *first,const int *last) {
+        bin.recycle(first,last);
+        for(; first != last ; ++first) map.erase({*first,0});
+    }
+
     /* Allocate a new node for further modification. */
     visitor allocate() { return insert_map({bin.allocate(),1}); }
 
+    /**
+     * @brief Allocate __n contiguous new nodes , bypassing the cache.
+     * Users should write them with write_object.
+     * 
+     * @return Index of the first node.
+     */
+    int allocate_range(size_t __n) { return bin.allocate_range(__n); }
+
     /* Skip the last block. Users should manage the block themselves. */
     void init() { bin.skip_block(); }
 
+    /**
+     * @brief Save ids of cached pages to the .hot file.
+     * Pages are ordered by rank (smaller first) , then from most
+     * recently used to least. Nothing is written back here.
+     * 
+     * @param rank Function ranking a page , such as by its level.
+     */
+    template <class rank_func>
+    void save_hot(rank_func &&rank) {
+        if(hot_path.empty()) return;
+        trivial_array <std::pair <int,int>> order; /* Rank and index. */
+        order.reserve(map.size());
+        for(auto &&iter : map) order.push_back({rank(iter.second),iter.first.index});
+        std::reverse(order.data(),order.data() + order.size());
+        std::stable_sort(order.data(),order.data() + order.size(),
+            [](const auto &x,const auto &y) { return x.first < y.first; });
+
+        trivial_array <int> index;
+        index.reserve(order.size());
+        for(auto &&iter : order) index.push_back(iter.second);
+
+        storage_t hot_file;
+        hot_file.open(hot_path);
+        size_t count = index.size();
+        hot_file.write(&count,0,sizeof(count));
+        hot_file.write(index.data(),sizeof(count),count * sizeof(int));
+    }
+
+    /**
+     * @brief Warm up the cache with pages listed in the .hot file.
+     * Only as many pages as free cache slots are taken from the front.
+     * They are read in sorted order , with close pages coalesced
+     * into one large read , and then touched from cold to hot
+     * so that the recency of last run is restored.
+     * 
+     * @return Count of pages loaded.
+     */
+    size_t load_hot() {
+        storage_t hot_file;
+        if(hot_path.empty() || !hot_file.open(hot_path)) return 0;
+        if(hot_file.size() < sizeof(size_t)) return 0;
+        size_t count = 0;
+        hot_file.read(&count,0,sizeof(count));
+        count = std::min({count,cache_size - map.size(),
+                          (hot_file.size() - sizeof(count)) / sizeof(int)});
+
+        trivial_array <int> order; /* Hot to cold. */
+        order.resize(count);
+        hot_file.read(order.data(),sizeof(count),count * sizeof(int));
+        hot_file.close();
+
+        /* Drop stale or cached pages. Page 0 is never cached. */
+        int *__e = std::remove_if(order.data(),order.data() + order.size(),[this](int x) {
+            return x <= 0 || size_t(x) >= bin.size() || map.find_pre({x,0}).next_data();
+        });
+        order.resize(__e - order.data());
+
+        trivial_array <int> index = order;
+        std::sort(index.data(),index.data() + index.size());
+        index.resize(std::unique(index.data(),index.data() + index.size()) - index.data());
+
+        trivial_array <char,tagged_allocator <char,tag::buffer_pool>> buffer;
+        for(size_t i = 0 ; i != index.size() ;) {
+            size_t j = i + 1;
+            while(j != index.size()
+               && size_t(index[j] - index[j - 1]) <= kHOLE + 1
+               && size_t(index[j] - index[i]) <  kSPAN) ++j;
+
+            /* One read from the first page to the end of the last page. */
+            size_t first  = size_t(index[i]) * page_size;
+            size_t length = size_t(index[j - 1] - index[i]) * page_size + io_size;
+            buffer.resize(length);
+            dat_file.read(buffer.data(),first,length);
+            for(; i != j ; ++i) {
+                memcpy(&cache,buffer.data() + (size_t(index[i]) * page_size - first),io_size);
+                map.insert({index[i],0},cache);
+            }
+        }
+
+        /* Restore recency. The hottest page is accessed last. */
+        for(size_t i = order.size() ; i-- ;) map.find_pre({order[i],0});
+        return index.size();
+    }
+
     /* Read object from disk at given index. */
     void read_object(T &obj,int index) {
-        dat_file.seekg(index * page_size);
-        dat_file.read((char *)&obj,page_size);
+        dat_file.read(&obj,size_t(index) * page_size,io_size);
     }
 
     /* Write object to disk at given index. */
     void write_object(const T &obj,int index) {
-        dat_file.seekp(index * page_size);
-        dat_file.write((const char *)&obj,page_size);
+        dat_file.write(&obj,size_t(index) * page_size,io_size);
+    }
+
+    /* Hint the storage to read the object at given index ahead. */
+    void prefetch(int index) {
+        dat_file.will_need(size_t(index) * page_size,io_size);
+    }
+
+    /**
+     * @brief Read [offset,offset + length) of object at given index.
+     * A cached object is read from the cache. Otherwise only the
+     * field is read from disk , and the object is not cached.
+     */
+    void read_field(void *dst,int index,size_t offset,size_t length) {
+        if(auto *__p = map.find_pre({index,0}).next_data())
+            memcpy(dst,(const char *)&__p->second + offset,length);
+        else dat_file.read(dst,size_t(index) * page_size + offset,length);
+    }
+
+    /**
+     * @brief Write [offset,offset + length) of object at given index.
+     * A cached object is updated in cache , dirtying only sectors
+     * of the field. Otherwise only the field is written to disk.
+     */
+    void write_field(const void *src,int index,size_t offset,size_t length) {
+        if(auto *__p = map.find_pre({index,0}).next_data()) {
+            memcpy((char *)&__p->second + offset,src,length);
+            visitor {__p}.modify_range(offset,length);
+        } else dat_file.write(src,size_t(index) * page_size + offset,length);
+    }
+
+    /* Write all modified cached data to disk. They stay cached. */
+    void flush() {
+        for(auto &&iter : map) {
+            if(!iter.first.is_modified()) continue;
+            write_back(iter.first,iter.second);
+            iter.first.state = false;
+        }
     }
 
     /* Count of all nodes. */
@@ -138,23 +307,145 @@ class cached_file_manager {
 
     /* Whether node count is zero. */
     bool empty() const noexcept { return !bin.size(); }
+
+    /* Storage of the data file. */
+    storage_t &storage() noexcept { return dat_file; }
+};
+
+
+/**
+ * @brief Read-only file manager over a memory-mapped file.
+ * Pages are visited in place , so there is no cache , no rubbish bin
+ * and no write back. The .bin file is never touched.
+ * 
+ * @tparam T         The inner data type.
+ * @tparam page_size Size of a page.
+ * @tparam storage_t Read-only storage with data() , such as mapped_storage.
+ */
+template <
+    class T,
+    size_t page_size = ((sizeof(T) - 1) / 4096 + 1) * 4096,
+    class storage_t  = mapped_storage
+>
+class mapped_file_manager {
+  private:
+    static_assert(storage_t::read_only,"Storage should be read-only!");
+
+    /* Bytes moved per page. The tail of T beyond a page is never stored. */
+    static constexpr size_t io_size = sizeof(T) < page_size ? sizeof(T) : page_size;
+
+    storage_t   dat_file; /* Pure data file. */
+    std::string hot_path; /* Path of hot page list. */
+
+  public:
+    /* Visitor to a page in the mapping. */
+    struct visitor {
+        T  *__p; /* Data of the page. */
+        int __i; /* Index of the page. */
+
+        visitor() = default;
+        visitor(T *__t,int __n) noexcept : __p(__t),__i(__n) {}
+        /* Visit data held by the user , such as the root. */
+        visitor(std::pair <file_state,T> *__t) noexcept :
+            __p(__t ? &__t->second : nullptr),__i(__t ? __t->first.index : 0) {}
+
+        inline bool is_modified() noexcept { return false; }
+
+        inline T &data() { return *__p; }
+
+        T &operator * () const noexcept { return *__p; }
+        T *operator ->() const noexcept { return  __p; }
+
+        inline int index() const noexcept { return __i; }
+    };
+
+    /* Can't start from nothing. */
+    mapped_file_manager() = delete;
+
+    /**
+     * @brief Construct a new file manager object.
+     * 
+     * @param __dat The path for .dat file.
+     * @param __bin Unused. Kept to match other managers.
+     * @param __hot The path for .hot file. Empty if no warm-up.
+     */
+    mapped_file_manager(std::string __dat,std::string,std::string __hot = "")
+    noexcept : hot_path(std::move(__hot)) { dat_file.open(__dat); }
+
+    /* Return reference to given data. */
+    visitor get_object(int index) {
+        return {(T *)(dat_file.data() + size_t(index) * page_size),index};
+    }
+
+    /* Read object from disk at given index. */
+    void read_object(T &obj,int index) {
+        dat_file.read(&obj,size_t(index) * page_size,io_size);
+    }
+
+    /* Hint the OS to read the object at given index ahead. */
+    void prefetch(int index) {
+        dat_file.will_need(size_t(index) * page_size,io_size);
+    }
+
+    /* Nothing is ever modified. */
+    void flush() {}
+
+    /* Nothing to save , for the cache belongs to the OS. */
+    template <class rank_func>
+    void save_hot(rank_func &&) {}
+
+    /**
+     * @brief Ask the OS to read ahead pages listed in the .hot file.
+     * 
+     * @return Count of pages hinted.
+     */
+    size_t load_hot() {
+        storage_t hot_file;
+        if(hot_path.empty() || !hot_file.open(hot_path)) return 0;
+        if(hot_file.size() < sizeof(size_t)) return 0;
+        size_t count = 0;
+        hot_file.read(&count,0,sizeof(count));
+        count = std::min(count,(hot_file.size() - sizeof(count)) / sizeof(int));
+
+        trivial_array <int> index;
+        index.resize(count);
+        hot_file.read(index.data(),sizeof(count),count * sizeof(int));
+        std::sort(index.data(),index.data() + index.size());
+        for(int x : index)
+            if(x > 0) dat_file.will_need(size_t(x) * page_size,io_size);
+        return count;
+    }
+
+    /* Count of pages in the file. */
+    size_t size() const noexcept { return (dat_file.size() + page_size - 1) / page_size; }
+
+    /* Whether node count is zero. */
+    bool empty() const noexcept { return !dat_file.size(); }
+
+    /* Storage of the data file. */
+    storage_t &storage() noexcept { return dat_file; }
 };
 
 
 /**
  * @brief Uncached file manager for indirect IO.
  * 
- * @tparam T    Template class.
- * @tparam 4096 Size of one page.
+ * @tparam T         Template class.
+ * @tparam page_size Size of one page.
+ * @tparam storage_t Storage backend of the files.
  */
 template <
     class T,
-    size_t page_size = ((sizeof(T) - 1) / 4096 + 1) * 4096
+    size_t page_size = ((sizeof(T) - 1) / 4096 + 1) * 4096,
+    class storage_t  = file_storage
 >
-class file_manager : public rubbish_bin {
+class file_manager : public rubbish_bin <storage_t> {
   private:
 
-    std::fstream dat_file; /* Pure data file. */
+    /* Bytes moved per page. The tail of T beyond a page is never stored. */
+    static constexpr size_t io_size = sizeof(T) < page_size ? sizeof(T) : page_size;
+
+    storage_t dat_file; /* Pure data file. */
 
   public:
 
@@ -168,41 +459,35 @@ class file_manager : public rubbish_bin {
      * @param __bin The path for .bin file.
      */
     file_manager(std::string __dat,std::string __bin) noexcept :
-        rubbish_bin(__bin), dat_file(__dat,std::ios::in | std::ios::out | std::ios::binary)  {
-        if(!dat_file.good()) {
-            dat_file.close(); dat_file.open(__dat,std::ios::out);
-            dat_file.close(); dat_file.open(__dat,std::ios::in | std::ios::out | std::ios::binary);
-        }
-    }
+        rubbish_bin <storage_t> (__bin) { dat_file.open(__dat); }
 
     /* Write out information. */
     ~file_manager() = default;
 
     /* Read object from disk at given index. */
     void read_object(T &obj,int index) {
-        dat_file.seekg(index * page_size);
-        dat_file.read((char *)&obj,page_size);
+        dat_file.read(&obj,size_t(index) * page_size,io_size);
     }
 
     void read_object(T &obj,int index,int offset,int length) {
-        dat_file.seekg(index * page_size + offset);
-        dat_file.read(((char *)&obj) + offset,length);
+        dat_file.read(((char *)&obj) + offset,size_t(index) * page_size + offset,length);
     }
 
     /* Write object to disk at given index. */
     void write_object(const T &obj,int index) {
-        dat_file.seekp(index * page_size);
-        dat_file.write((const char *)&obj,page_size);
+        dat_file.write(&obj,size_t(index) * page_size,io_size);
     }
 
     /* Read object from disk at given index. */
     void write_object(const T &obj,int index,int offset,int length) {
-        dat_file.seekp(index * page_size + offset);
-        dat_file.write(((const char *)&obj) + offset,length);
+        dat_file.write(((const char *)&obj) + offset,size_t(index) * page_size + offset,length);
     }
 
     /* Whether node count is zero. */
-    bool empty() const noexcept { return !size(); }
+    bool empty() const noexcept { return !this->size(); }
+
+    /* Storage of the data file. */
+    storage_t &storage() noexcept { return dat_file; }
 };
 
 
@@ -210,8 +495,10 @@ template <
     class T,
     size_t kTABLESIZE
 >
-class external_hash_set : public linked_hash_set <T,kTABLESIZE> {
+class external_hash_set : public linked_hash_set <T,kTABLESIZE,std::hash <T>,
+    std::equal_to <T>,tagged_allocator <T,tag::hash_table>> {
   private:
+    using array_t = trivial_array <T,tagged_allocator <T,tag::hash_table>>;
     std::fstream file;
   public:
 
@@ -226,7 +513,7 @@ class external_hash_set : public linked_hash_set <T,kTABLESIZE> {
             file.read((char *)&count,sizeof(count));
 
             /* Construct the array for read-in. */
-            dark::trivial_array <T> t; t.resize(count);
+            array_t t; t.resize(count);
             file.read((char *)t.data(),count * sizeof(T));
 
             /* Fill the set with data. */
@@ -236,7 +523,7 @@ class external_hash_set : public linked_hash_set <T,kTABLESIZE> {
 
     ~external_hash_set() {
         this->shrink(); /* Release space first in case of MLE. */
-        dark::trivial_array <T> t;
+        array_t t;
         t.reserve(this->size());
         for(auto &&iter : *this) t.copy_back(iter);
 
@@ -1,40 +1,77 @@
 #include "bplus.h"
 #include "Dark/inout"
 #include "string.h"
+#include "command.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "shard.h"
+#include "result_cache.h"
 #include <filesystem>
 
-size_t hash_str(const char *str) {
-    static size_t fix_random = rand() * rand();
-    size_t __h = fix_random;
-    while(*str) { __h = __h * 137 + *(str++); }
-    return __h;
-}
-
-signed main() {
+/**
+ * Usage: code [--record trace_file] [--serial | --pipeline] [--shards n]
+ *             [--cache mb] < commands
+ *
+ * --record   : record commands into a trace file.
+ * --serial   : run on one thread.
+ * --pipeline : run parse / execute / format on three threads.
+ *              This is the default when there are at least 2 cores.
+ * --shards   : split the index into n trees by key hash ,
+ *              each with its own cache and worker thread.
+ * --cache    : keep results of hot keys in a cache of given MiB.
+ */
+signed main(int argc,char **argv) {
     using tree = dark::bpt <size_t,int,1023,10000,2>;
     typename tree::return_list data;
     typename tree::iterator    iter;
+    dark::trace::writer recorder;
+    bool   serial = std::thread::hardware_concurrency() < 2;
+    size_t shards = 1;
+    size_t cache  = 0;
+    for(int i = 1 ; i < argc ; ++i) {
+        if     (!strcmp(argv[i],"--serial"))   serial = true;
+        else if(!strcmp(argv[i],"--pipeline")) serial = false;
+        else if(!strcmp(argv[i],"--shards") && i + 1 < argc) shards = atoi(argv[++i]);
+        else if(!strcmp(argv[i],"--cache")  && i + 1 < argc) cache  = atoi(argv[++i]);
+        else if(!strcmp(argv[i],"--record") && i + 1 < argc) {
+            if(!recorder.open(argv[++i])) {
+                fprintf(stderr,"Cannot open trace file %s\n",argv[i]);
+                return 1;
+            }
+        }
+    }
     std::filesystem::create_directory("output");
-    tree t("output/a");
     int n = dark::read <int> ();
     dark::string <68> str;
-    while(n--) {
+    dark::string <68> key;
+
+    auto parse = [&](dark::command &c) {
+        if(!n) return false;
+        --n;
         dark::read(str.str);
-        if(str.str[0] == 'i') {
-            dark::read(str.str);
-            t.insert(hash_str(str.base()),dark::read <int> ());
-        } else if(str.str[0] == 'd') {
-            dark::read(str.str);
-            t.erase(hash_str(str.base()),dark::read <int> ());
-        } else {
+        dark::read(key.str);
+        c.op  = str.str[0];
+        c.val = c.op == 'i' || c.op == 'd' ? dark::read <int> () : 0;
+        if(recorder.is_open()) recorder.record(c.op,key.base(),c.val);
+        c.key = dark::hash_str(key.base());
+        return true;
+    };
+
+    if(shards > 1) {
+        dark::sharded <tree> (std::string("output/a"),shards).run(parse,stdout);
+        return 0;
+    }
+
+    auto serve = [&](auto &t) {
+        using tree_t = std::decay_t <decltype(t)>;
+        if(!serial) return dark::pipeline <tree_t>::run(t,parse,stdout);
+        while(n--) {
             dark::read(str.str);
-            data.clear();
-            t.find(hash_str(str.base()),data);
-            if(data.empty()) puts("null");
-            else {
-                for(auto iter : data) dark::print(iter,' ');
-                putchar('\n');
-            }
+            dark::read(key.str);
+            char op = str.str[0];
+            int val = op == 'i' || op == 'd' ? dark::read <int> () : 0;
+            if(recorder.is_open()) recorder.record(op,key.base(),val);
+            dark::run_command(t,op,key.base(),val,data);
             // size_t __h = hash_str(str.base());
             // iter = t.find(__h);
             // if(!iter.valid() || iter->key != __h) puts("null");
@@ -45,6 +82,12 @@ signed main() {
             //     putchar('\n');
             // }
         }
-    }
+    };
+
+    tree t("output/a");
+    if(cache) {
+        dark::result_cache <tree> c(t,cache << 20);
+        serve(c);
+    } else serve(t);
     return 0;
 }
@@ -0,0 +1,96 @@
+#ifndef _DARK_NEGATIVE_CACHE_H_
+#define _DARK_NEGATIVE_CACHE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace dark {
+
+/**
+ * @brief Bounded set of keys recently found missing.
+ * It is set-associative: a key may only sit in one of kWAYS slots of
+ * its set , and a full set evicts by the clock algorithm , so every
+ * operation touches one small set of contiguous slots.
+ * Whole keys are kept as fingerprints , so a hit is never a false one.
+ *
+ * @tparam key_t Trivially copyable key type.
+ * @tparam kSETS Count of sets. Must be a power of 2.
+ * @tparam kWAYS Slots per set. No more than 8.
+ */
+template <class key_t,size_t kSETS,size_t kWAYS = 8,
+          class Hash = std::hash <key_t>,class Equal = std::equal_to <key_t>>
+class negative_cache {
+  private:
+    static_assert(kSETS && !(kSETS & (kSETS - 1)),"Size should be power of 2!");
+    static_assert(kWAYS && kWAYS <= 8,"Too many ways!");
+
+    struct set {
+        key_t   key[kWAYS];
+        uint8_t valid; /* Bit i : slot i is used. */
+        uint8_t ref;   /* Bit i : slot i is hit since the hand passed. */
+        uint8_t hand;  /* Next slot to consider for eviction. */
+    };
+
+    set table[kSETS];
+
+    static set &locate(set *__t,const key_t &key) noexcept {
+        uint64_t __h = Hash()(key) * 0x9E3779B97F4A7C15ull;
+        return __t[(__h >> 32) & (kSETS - 1)];
+    }
+
+    /* Slot of key in the set , or kWAYS if absent. */
+    static size_t slot(const set &__s,const key_t &key) noexcept {
+        for(size_t i = 0 ; i != kWAYS ; ++i)
+            if((__s.valid >> i & 1) && Equal()(__s.key[i],key)) return i;
+        return kWAYS;
+    }
+
+  public:
+
+    negative_cache() noexcept { clear(); }
+
+    /* Whether key is known missing. Marks it recently used. */
+    bool contains(const key_t &key) noexcept {
+        set &__s = locate(table,key);
+        size_t i = slot(__s,key);
+        if(i == kWAYS) return false;
+        __s.ref |= 1 << i;
+        return true;
+    }
+
+    /* Record key as missing. Key must not be recorded yet. */
+    void insert(const key_t &key) noexcept {
+        set &__s = locate(table,key);
+        size_t i = 0;
+        constexpr uint8_t kFULL = (1u << kWAYS) - 1;
+        if(__s.valid != kFULL) { /* Take a free slot. */
+            while(__s.valid >> i & 1) ++i;
+        } else for(;;) { /* Clock: skip and clear hit slots. */
+            i = __s.hand;
+            __s.hand = (i + 1) % kWAYS;
+            if(!(__s.ref >> i & 1)) break;
+            __s.ref &= ~(1 << i);
+        }
+        __s.key[i] = key;
+        __s.valid |=  (1 << i);
+        __s.ref   &= ~(1 << i);
+    }
+
+    /* Forget key , since it may exist now. */
+    void erase(const key_t &key) noexcept {
+        set &__s = locate(table,key);
+        size_t i = slot(__s,key);
+        if(i != kWAYS) __s.valid &= ~(1 << i);
+    }
+
+    /* Forget all keys. */
+    void clear() noexcept {
+        for(set &__s : table) __s.valid = __s.ref = __s.hand = 0;
+    }
+};
+
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef _DARK_ORDER_LOG_H_
+#define _DARK_ORDER_LOG_H_
+
+#include "file_manager.h"
+
+#include <cstddef>
+#include <type_traits>
+
+namespace dark {
+
+/**
+ * @brief Persistent append-only logs of fixed-size entries ,
+ * read newest first. Many logs share one file. A log is a chain of
+ * pages from the newest page to the oldest , and the caller keeps its
+ * handle , such as in the user record. Entries of one log are packed
+ * together , so listing n entries reads about n / kCAP pages.
+ *
+ * Every entry has a fixed position , by which it can be read or
+ * updated in place with one page access , such as to change the
+ * status of an order.
+ *
+ * @tparam T Trivially copyable entry type.
+ */
+template <class T>
+class order_log {
+  public:
+    /* Handle of one log. Keep it with the owner of the log. */
+    struct handle {
+        int head = -1; /* Newest page , -1 if empty. */
+        int size =  0; /* Count of entries. */
+    };
+
+  private:
+    static_assert(std::is_trivially_copyable_v <T>,"Entry must be trivially copyable!");
+
+    static constexpr size_t kPAGE = 4096;
+    /* Entries per page. */
+    static constexpr int    kCAP  = (kPAGE - 8) / sizeof(T);
+    static_assert(kCAP > 0,"Entry too large!");
+
+    struct page {
+        int next;  /* Older page , -1 if oldest. */
+        int count; /* Entries in the page , oldest first. */
+        T data[kCAP];
+    };
+
+    cached_file_manager <page,1031,256,kPAGE> pages;
+
+    static size_t offset(int i) noexcept { return offsetof(page,data) + i * sizeof(T); }
+
+  public:
+
+    /* Position of an entry in the file. */
+    using position = size_t;
+
+    /* Open the logs with files at path. */
+    explicit order_log(const std::string &path) :
+        pages(path + ".log",path + ".log.bin") {}
+
+    order_log(const order_log &) = delete;
+
+
+    /* Append an entry as the newest of a log. Return its position. */
+    position push(handle &__h,const T &x) {
+        if(__h.head == -1 || pages.get_object(__h.head)->count == kCAP) {
+            auto pointer = pages.allocate();
+            pointer->next  = __h.head;
+            pointer->count = 0;
+            __h.head = pointer.index();
+        }
+        auto pointer = pages.get_object(__h.head);
+        int i = pointer->count++;
+        pointer->data[i] = x;
+        pointer.modify_range(0,offsetof(page,data));
+        pointer.modify_range(offset(i),sizeof(T));
+        ++__h.size;
+        return position(__h.head) * kCAP + i;
+    }
+
+
+    /* Read the entry at a position. */
+    void get(position __p,T &x) { x = pages.get_object(__p / kCAP)->data[__p % kCAP]; }
+
+    /* Overwrite the entry at a position. */
+    void set(position __p,const T &x) {
+        auto pointer = pages.get_object(__p / kCAP);
+        pointer->data[__p % kCAP] = x;
+        pointer.modify_range(offset(__p % kCAP),sizeof(T));
+    }
+
+    /* Update the entry at a position in place by func(T &). */
+    template <class func_t>
+    void modify(position __p,func_t &&func) {
+        auto pointer = pages.get_object(__p / kCAP);
+        func(pointer->data[__p % kCAP]);
+        pointer.modify_range(offset(__p % kCAP),sizeof(T));
+    }
+
+
+    /**
+     * @brief Position of the n-th newest entry of a log , from 0.
+     * Whole pages before it are skipped by their count.
+     *
+     * @return Its position , or -1 if n is out of range.
+     */
+    position locate(const handle &__h,int n) {
+        if(n < 0 || n >= __h.size) return position(-1);
+        for(int index = __h.head ;;) {
+            auto pointer = pages.get_object(index);
+            if(n < pointer->count) return position(index) * kCAP + (pointer->count - 1 - n);
+            n -= pointer->count;
+            index = pointer->next;
+        }
+    }
+
+
+    /**
+     * @brief Visit entries of a log from newest to oldest.
+     * func(position,const T &) returns whether to go on.
+     */
+    template <class func_t>
+    void for_each(const handle &__h,func_t &&func) {
+        for(int index = __h.head ; index != -1 ;) {
+            auto pointer = pages.get_object(index);
+            for(int i = pointer->count ; i-- ;)
+                if(!func(position(index) * kCAP + i,pointer->data[i])) return;
+            index = pointer->next;
+        }
+    }
+};
+
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef _DARK_PIPELINE_H_
+#define _DARK_PIPELINE_H_
+
+#include "command.h"
+#include "Dark/spsc_queue"
+#include "Dark/trivial_array"
+
+#include <thread>
+#include <cstdio>
+
+namespace dark {
+
+/* One parsed command , with its key hashed. */
+struct command {
+    size_t key; /* Hash of the key string. */
+    int    val; /* Value of insert / delete. */
+    char   op;  /* 'i'nsert / 'd'elete / 'f'ind */
+};
+
+
+/**
+ * @brief Three-stage command pipeline.
+ * The parser thread tokenizes and hashes commands into batches ,
+ * the calling thread executes them on the tree , and the formatter
+ * thread renders results of find. Batches go through SPSC queues
+ * in order , so the output is in input order.
+ *
+ * @tparam tree_t Type of the tree.
+ */
+template <class tree_t>
+class pipeline {
+  private:
+    static constexpr size_t kBATCH = 1024;    /* Commands per batch. */
+    static constexpr size_t kDEPTH = 8;       /* Batches in flight. */
+    static constexpr size_t kFLUSH = 1 << 16; /* Output bytes per write. */
+
+    struct batch {
+        trivial_array <command>        cmd;   /* Commands in order. */
+        typename tree_t::return_list   value; /* Results of all finds. */
+        trivial_array <size_t>         end;   /* End of each find result in value. */
+    };
+
+    using queue_t = spsc_queue <batch *,kDEPTH>;
+
+    /* Execute a batch on the tree. */
+    static void execute(tree_t &t,batch &b) {
+        b.value.clear();
+        b.end.clear();
+        for(const command &c : b.cmd) {
+            if(c.op == 'i' || c.op == 'd') {
+                if constexpr (!tree_t::read_only) {
+                    if(c.op == 'i') t.insert(c.key,c.val);
+                    else            t.erase (c.key,c.val);
+                }
+            } else {
+                t.find(c.key,b.value);
+                b.end.push_back(b.value.size());
+            }
+        }
+    }
+
+    /* Render results of a batch. */
+    template <class buffer_t>
+    static void format(const batch &b,buffer_t &buf) {
+        size_t last = 0;
+        for(size_t next : b.end) {
+            format_result(b.value.data() + last,b.value.data() + next,buf);
+            last = next;
+        }
+    }
+
+  public:
+
+    /**
+     * @brief Run commands through the pipeline until parse returns false.
+     *
+     * @param t     The tree. Only touched by the calling thread.
+     * @param parse Called on the parser thread to fill the next command.
+     *              Return whether there is one.
+     * @param out   File for results of find.
+     */
+    template <class parse_func>
+    static void run(tree_t &t,parse_func &&parse,FILE *out) {
+        batch   pool[kDEPTH];
+        queue_t free_queue;   /* Formatter -> parser.   */
+        queue_t exec_queue;   /* Parser    -> executor. */
+        queue_t format_queue; /* Executor  -> formatter. */
+        for(batch &b : pool) free_queue.push(&b);
+
+        std::thread parser([&] {
+            command c;
+            for(bool more = true ; more ;) {
+                batch *b = free_queue.pop();
+                b->cmd.clear();
+                while(b->cmd.size() != kBATCH && (more = parse(c))) b->cmd.copy_back(c);
+                exec_queue.push(b);
+            } exec_queue.push(nullptr);
+        });
+
+        std::thread formatter([&] {
+            trivial_array <char> buf;
+            for(batch *b ; (b = format_queue.pop()) ;) {
+                format(*b,buf);
+                free_queue.push(b);
+                if(buf.size() >= kFLUSH) {
+                    fwrite(buf.data(),1,buf.size(),out);
+                    buf.clear();
+                }
+            }
+            fwrite(buf.data(),1,buf.size(),out);
+            fflush(out);
+        });
+
+        for(batch *b ; (b = exec_queue.pop()) ;) {
+            execute(t,*b);
+            format_queue.push(b);
+        } format_queue.push(nullptr);
+
+        parser.join();
+        formatter.join();
+    }
+};
+
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef _DARK_QUERY_ENGINE_H_
+#define _DARK_QUERY_ENGINE_H_
+
+#include "bplus.h"
+#include "Dark/ranking"
+
+#include <algorithm>
+
+namespace dark {
+
+/* A one-transfer plan: first train to station , then second train. */
+template <class value_t,class score_t>
+struct transfer_plan {
+    score_t score;  /* Smaller is better. */
+    value_t first;  /* Train from the source. */
+    value_t second; /* Train to the target. */
+    size_t station; /* Transfer station. */
+    long   arrive;  /* Arrival of first at station. */
+    long   depart;  /* Departure of second from station. */
+};
+
+
+/**
+ * @brief Station-pair queries over a posting index.
+ * The index maps a station to ids of trains through it , so the
+ * values of a key form a sorted posting list.
+ *
+ * Direct trains are the intersection of two posting lists , merged
+ * by galloping cursors that stream from leaves without collecting
+ * either list. One-transfer plans join trains from the source with
+ * trains into the target on a temporary open-addressing hash of
+ * arrivals keyed by station. Both keep only the best k results
+ * by a score the caller defines , such as time or price , with ties
+ * broken by train id. They are kept by a bounded heap right in the
+ * output list.
+ *
+ * @tparam tree_t Type of the posting index.
+ */
+template <class tree_t>
+class query_engine {
+  public:
+    using key_t   = typename tree_t::key_type;
+    using value_t = typename tree_t::mapped_type;
+
+  private:
+    /* Arrivals of trains from the source , chained by station. */
+    class arrival_table {
+      private:
+        struct slot  { size_t station; int head; };
+        struct entry { value_t train; long time; int next; };
+
+        trivial_array <slot>  table;   /* Open addressing. head = -1 if empty. */
+        trivial_array <entry> entries; /* Chains of arrivals. */
+        size_t used; /* Slots taken. */
+        size_t mask; /* Size of table - 1. */
+
+        static size_t hash(size_t __x) noexcept
+        { return (__x * 0x9E3779B97F4A7C15ull) >> 20; }
+
+        /* Slot of station , or the empty slot it would take. */
+        slot &locate(size_t station) noexcept {
+            size_t i = hash(station) & mask;
+            while(table[i].head != -1 && table[i].station != station) i = (i + 1) & mask;
+            return table[i];
+        }
+
+        void rehash(size_t __n) {
+            trivial_array <slot> old = std::move(table);
+            table.resize(__n,nullptr);
+            for(slot &__s : table) __s.head = -1;
+            mask = __n - 1;
+            for(const slot &__s : old)
+                if(__s.head != -1) locate(__s.station) = __s;
+        }
+
+      public:
+
+        arrival_table() : used(0),mask(0) { rehash(64); }
+
+        /* Add an arrival of train at station. */
+        void insert(size_t station,const value_t &train,long time) {
+            if((used + 1) * 2 > mask + 1) rehash((mask + 1) * 2);
+            slot &__s = locate(station);
+            if(__s.head == -1) __s.station = station,++used;
+            entries.push_back({train,time,__s.head});
+            __s.head = entries.size() - 1;
+        }
+
+        /* Call func(train,time) for each arrival at station. */
+        template <class func_t>
+        void for_each(size_t station,func_t &&func) {
+            for(int i = locate(station).head ; i != -1 ; i = entries[i].next)
+                func(entries[i].train,entries[i].time);
+        }
+    };
+
+    tree_t &t;
+
+  public:
+
+    explicit query_engine(tree_t &__t) : t(__t) {}
+
+
+    /* Call func(value) for each value under both keys , ascending. */
+    template <class func_t>
+    void intersect(const key_t &a,const key_t &b,func_t &&func) {
+        auto x = t.find_cursor(a);
+        if(!x.valid()) return;
+        auto y = t.find_cursor(b);
+        while(x.valid() && y.valid()) {
+            if(*x < *y)      x.seek(*y);
+            else if(*y < *x) y.seek(*x);
+            else { func(*x); ++x; ++y; }
+        }
+    }
+
+
+    /* Append values under both keys to out , ascending. */
+    template <class list_t>
+    void intersect(const key_t &a,const key_t &b,list_t &out)
+    { intersect(a,b,[&out](const value_t &x) { out.push_back(x); }); }
+
+
+    /**
+     * @brief Best k trains through both stations.
+     *
+     * @param score Called as score(train,score_t &s). Return false to
+     *              drop the train , such as one running from b to a.
+     * @param out   Pairs of score and train , from best to worst.
+     *              Ties are in order of train.
+     */
+    template <class score_t,class score_func>
+    void direct(const key_t &a,const key_t &b,size_t k,score_func &&score,
+                trivial_array <std::pair <score_t,value_t>> &out) {
+        using result = std::pair <score_t,value_t>;
+        auto better  = [](const result &x,const result &y) { return x < y; };
+        top_k best(out,k,better);
+        intersect(a,b,[&](const value_t &train) {
+            result __r;
+            __r.second = train;
+            if(score(train,__r.first)) best.push(__r);
+        });
+        best.finish();
+    }
+
+
+    /**
+     * @brief Best k plans from station a to station b with one transfer.
+     *
+     * @param from_a Called as from_a(train,emit) for each train through a.
+     *               It calls emit(station,arrive) for each station after a.
+     * @param into_b Called as into_b(train,emit) for each train through b.
+     *               It calls emit(station,depart) for each station before b.
+     * @param score  Called as score(plan,score_t &s) for each plan with
+     *               different trains and arrive <= depart. Return false
+     *               to drop the plan.
+     * @param out    Plans from best to worst. Ties are in order of
+     *               the first train , then the second.
+     */
+    template <class score_t,class leg_a,class leg_b,class score_func>
+    void transfer(const key_t &a,const key_t &b,size_t k,
+                  leg_a &&from_a,leg_b &&into_b,score_func &&score,
+                  trivial_array <transfer_plan <value_t,score_t>> &out) {
+        using plan_t = transfer_plan <value_t,score_t>;
+        auto better  = [](const plan_t &x,const plan_t &y) {
+            if(x.score < y.score) return true;
+            if(y.score < x.score) return false;
+            if(x.first < y.first) return true;
+            if(y.first < x.first) return false;
+            return x.second < y.second;
+        };
+        top_k best(out,k,better);
+        arrival_table arrivals;
+        for(auto x = t.find_cursor(a) ; x.valid() ; ++x) {
+            const value_t train = *x;
+            from_a(train,[&](size_t station,long arrive)
+                { arrivals.insert(station,train,arrive); });
+        }
+        for(auto y = t.find_cursor(b) ; y.valid() ; ++y) {
+            const value_t train = *y;
+            into_b(train,[&](size_t station,long depart) {
+                arrivals.for_each(station,[&](const value_t &first,long arrive) {
+                    if(first == train || depart < arrive) return;
+                    plan_t __p;
+                    __p.first   = first;
+                    __p.second  = train;
+                    __p.station = station;
+                    __p.arrive  = arrive;
+                    __p.depart  = depart;
+                    if(score(__p,__p.score)) best.push(__p);
+                });
+            });
+        }
+        best.finish();
+    }
+};
+
+
+}
+
+#endif
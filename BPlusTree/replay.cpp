@@ -0,0 +1,127 @@
+#include "bplus.h"
+#include "command.h"
+#include "trace.h"
+
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <filesystem>
+
+/**
+ * Replay a recorded command trace against an engine configuration.
+ * Usage: replay trace_file [--config name] [--storage file|memory|mapped]
+ *                          [--dir path] [--keep] [--paced] [--quiet]
+ *
+ * --config  : default | small_cache | small_block | large_block
+ * --storage : file (default) , memory , which reports IO counters ,
+ *             or mapped , which opens existing files read-only
+ *             and skips insert / delete.
+ * --dir     : directory of index files. (replay by default)
+ * --keep    : reuse existing index files instead of starting empty.
+ * --paced   : replay at recorded pace instead of as fast as possible.
+ * --quiet   : do not print results of find.
+ */
+
+namespace {
+
+struct option {
+    const char *trace   = nullptr;
+    const char *config  = "default";
+    const char *storage = "file";
+    const char *dir     = "replay";
+    bool keep  = false;
+    bool paced = false;
+    bool quiet = false;
+};
+
+/* Print IO counters if the storage keeps them. */
+void report_io(dark::file_storage &) {}
+void report_io(dark::mapped_storage &) {}
+void report_io(dark::memory_storage &__s) {
+    dark::io_stats __t = __s.stats();
+    fprintf(stderr,"io during replay: reads %zu (%zu blocks) , writes %zu (%zu blocks) , "
+                   "sequential %zu , random %zu\n",
+            __t.reads,__t.read_blocks,__t.writes,__t.write_blocks,
+            __t.sequential,__t.random);
+}
+
+/* Replay the whole trace on given tree type. */
+template <class tree_t>
+int replay(dark::trace::reader &input,const option &opt) {
+    using clock = std::chrono::steady_clock;
+    std::string path = std::string(opt.dir) + "/a";
+    if(!tree_t::read_only) { /* Read-only storage always keeps files. */
+        if(!opt.keep) {
+            std::filesystem::remove(path + ".dat");
+            std::filesystem::remove(path + ".bin");
+            std::filesystem::remove(path + ".hot");
+        }
+        std::filesystem::create_directory(opt.dir);
+    }
+
+    /* Find results are thrown away in quiet mode. */
+    if(opt.quiet && !freopen("/dev/null","w",stdout)) return 1;
+
+    size_t count = 0,skipped = 0;
+    auto start = clock::now();
+    {
+        tree_t t(path);
+        typename tree_t::return_list data;
+        dark::trace::entry e;
+        while(input.next(e)) {
+            if(opt.paced)
+                std::this_thread::sleep_until(start + std::chrono::microseconds(e.time));
+            if(tree_t::read_only && (e.op == 'i' || e.op == 'd')) { ++skipped; continue; }
+            dark::run_command(t,e.op,e.key,e.val,data);
+            ++count;
+        }
+        fflush(stdout);
+        report_io(t.storage());
+    } /* Write back is part of the cost. */
+    double sec = std::chrono::duration <double> (clock::now() - start).count();
+    fprintf(stderr,"%zu commands in %.3f s , %.0f commands/s\n",
+            count,sec,sec > 0 ? count / sec : 0.0);
+    if(skipped) fprintf(stderr,"%zu insert / delete skipped by read-only storage\n",skipped);
+    return 0;
+}
+
+template <class storage_t>
+int dispatch(dark::trace::reader &input,const option &opt) {
+    if(!strcmp(opt.config,"default"))
+        return replay <dark::bpt <size_t,int,1023,10000,2,storage_t>> (input,opt);
+    if(!strcmp(opt.config,"small_cache"))
+        return replay <dark::bpt <size_t,int,1023,1000 ,2,storage_t>> (input,opt);
+    if(!strcmp(opt.config,"small_block"))
+        return replay <dark::bpt <size_t,int,1023,20000,1,storage_t>> (input,opt);
+    if(!strcmp(opt.config,"large_block"))
+        return replay <dark::bpt <size_t,int,1023,5000 ,4,storage_t>> (input,opt);
+    fprintf(stderr,"Unknown config %s\n",opt.config);
+    return 1;
+}
+
+}
+
+
+signed main(int argc,char **argv) {
+    option opt;
+    for(int i = 1 ; i < argc ; ++i) {
+        if     (!strcmp(argv[i],"--config")  && i + 1 < argc) opt.config  = argv[++i];
+        else if(!strcmp(argv[i],"--storage") && i + 1 < argc) opt.storage = argv[++i];
+        else if(!strcmp(argv[i],"--dir")     && i + 1 < argc) opt.dir     = argv[++i];
+        else if(!strcmp(argv[i],"--keep"))  opt.keep  = true;
+        else if(!strcmp(argv[i],"--paced")) opt.paced = true;
+        else if(!strcmp(argv[i],"--quiet")) opt.quiet = true;
+        else opt.trace = argv[i];
+    }
+    dark::trace::reader input;
+    if(!opt.trace || !input.open(opt.trace)) {
+        fprintf(stderr,"Usage: %s trace_file [--config name] [--storage file|memory|mapped]"
+                       " [--dir path] [--keep] [--paced] [--quiet]\n",argv[0]);
+        return 1;
+    }
+    if(!strcmp(opt.storage,"file"))   return dispatch <dark::file_storage>   (input,opt);
+    if(!strcmp(opt.storage,"memory")) return dispatch <dark::memory_storage> (input,opt);
+    if(!strcmp(opt.storage,"mapped")) return dispatch <dark::mapped_storage> (input,opt);
+    fprintf(stderr,"Unknown storage %s\n",opt.storage);
+    return 1;
+}
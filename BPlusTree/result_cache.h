@@ -0,0 +1,226 @@
+#ifndef _DARK_RESULT_CACHE_H_
+#define _DARK_RESULT_CACHE_H_
+
+#include "utility.h"
+#include "Dark/LRU_map"
+#include "Dark/trivial_array"
+
+#include <cstdint>
+#include <cstring>
+
+namespace dark {
+
+/**
+ * @brief Count-min sketch of access frequency , with 4 bit counters.
+ * Counters are halved every sample additions , so old popularity fades.
+ */
+class frequency_sketch {
+  private:
+    static constexpr int kDEPTH = 4; /* Counters per key. */
+
+    trivial_array <uint8_t> table;
+    size_t mask;      /* Width - 1. Width is a power of 2. */
+    size_t additions; /* Increments since last halving. */
+    size_t sample;    /* Increments per halving. */
+
+    /* Index of key hash __h in row i. */
+    size_t index(size_t __h,int i) const noexcept {
+        uint64_t __x = (__h + i) * 0x9E3779B97F4A7C15ull;
+        __x ^= __x >> 29;
+        __x *= 0xBF58476D1CE4E5B9ull;
+        return (__x ^ __x >> 32) & mask;
+    }
+
+    /* Halve all counters. */
+    void reset() noexcept {
+        for(uint8_t &__c : table) __c >>= 1;
+        additions >>= 1;
+    }
+
+  public:
+
+    /* Sketch wide enough for about __n distinct keys. */
+    explicit frequency_sketch(size_t __n) : additions(0) {
+        size_t width = 64;
+        while(width < __n) width <<= 1;
+        table.resize(width,nullptr);
+        memset(table.data(),0,width);
+        mask   = width - 1;
+        sample = width * 8;
+    }
+
+    /* Record one access of key hash __h. */
+    void increment(size_t __h) noexcept {
+        for(int i = 0 ; i != kDEPTH ; ++i) {
+            uint8_t &__c = table[index(__h,i)];
+            if(__c != 15) ++__c;
+        }
+        if(++additions == sample) reset();
+    }
+
+    /* Estimated access count of key hash __h. */
+    int estimate(size_t __h) const noexcept {
+        int __m = 15;
+        for(int i = 0 ; i != kDEPTH ; ++i)
+            __m = std::min <int> (__m,table[index(__h,i)]);
+        return __m;
+    }
+};
+
+
+/**
+ * @brief Result cache in front of a tree.
+ * Maps a key to an immutable copy of all its values , so a hot key
+ * is found by one hash probe without touching the node cache.
+ * Entries are evicted in LRU order within a byte budget. A new entry
+ * is only admitted if it is accessed more often than the LRU victim
+ * (TinyLFU) , so one-off scans can't flush the hot set.
+ * insert / erase invalidate exactly the key they modify.
+ * Keys without values are not cached.
+ *
+ * It has the interface of the tree used by commands , so it can
+ * replace the tree in run_command , pipeline and sharded.
+ *
+ * @tparam tree_t     Type of the tree.
+ * @tparam TABLE_SIZE Length of hash table.
+ */
+template <class tree_t,size_t TABLE_SIZE = 4093>
+class result_cache {
+  public:
+    using return_list = typename tree_t::return_list;
+    static constexpr bool read_only = tree_t::read_only;
+
+  private:
+    using key_t   = typename tree_t::key_type;
+    using value_t = typename tree_t::mapped_type;
+    using alloc_t = tagged_allocator <value_t,tag::result_cache>;
+
+    /* Values of a key , owned by the cache. */
+    struct entry {
+        value_t *data;
+        size_t   size;
+    };
+
+    using map_t = linked_hash_map <key_t,entry,TABLE_SIZE,std::hash <key_t>,std::equal_to <key_t>,
+                                   tagged_allocator <std::pair <key_t,entry>,tag::result_cache>>;
+
+    /* Bytes charged per entry besides its values. */
+    static constexpr size_t kOVERHEAD = sizeof(std::pair <key_t,entry>) + 4 * sizeof(void *);
+
+    tree_t &t;
+    map_t   map;
+    frequency_sketch sketch;
+    [[no_unique_address]] alloc_t alloc;
+
+    size_t budget; /* Maximum bytes. */
+    size_t used;   /* Bytes in use. */
+    size_t hit;    /* Finds served by the cache. */
+    size_t miss;   /* Finds served by the tree. */
+
+    static size_t hash(const key_t &key) noexcept { return std::hash <key_t> ()(key); }
+
+    static size_t cost(size_t __n) noexcept { return kOVERHEAD + __n * sizeof(value_t); }
+
+    /* Free the values of an entry no longer in the map. */
+    void release(const entry &__e) noexcept {
+        used -= cost(__e.size);
+        alloc.deallocate(__e.data,__e.size);
+    }
+
+    /* Cache a copy of values of a key , if admitted. */
+    void admit(const key_t &key,const value_t *__p,size_t __n) {
+        const size_t bytes = cost(__n);
+        if(bytes > budget) return;
+        if(used + bytes > budget) {
+            const int freq = sketch.estimate(hash(key));
+            do {
+                auto *__v = map.last();
+                if(sketch.estimate(hash(__v->first)) >= freq) return;
+                entry __e = __v->second;
+                map.erase(__v->first);
+                release(__e);
+            } while(used + bytes > budget);
+        }
+        entry __e = {alloc.allocate(__n),__n};
+        memcpy(__e.data,__p,__n * sizeof(value_t));
+        map.insert(key,__e);
+        used += bytes;
+    }
+
+  public:
+
+    /**
+     * @brief Put a cache in front of a tree.
+     *
+     * @param __t      The tree. It must outlive the cache and
+     *                 must not be modified except through the cache.
+     * @param __budget Maximum bytes of cached entries.
+     */
+    result_cache(tree_t &__t,size_t __budget) :
+        t(__t),sketch(__budget / cost(1)),budget(__budget),used(0),hit(0),miss(0) {}
+
+    result_cache(const result_cache &) = delete;
+
+    ~result_cache() { clear(); }
+
+    /* Insert a key-value pair and invalidate the key. */
+    void insert(const key_t &key,const value_t &val) {
+        invalidate(key);
+        t.insert(key,val);
+    }
+
+    /* Erase a key-value pair and invalidate the key. */
+    void erase(const key_t &key,const value_t &val) {
+        invalidate(key);
+        t.erase(key,val);
+    }
+
+    /* Append all values of a key to v. */
+    void find(const key_t &key,return_list &v) {
+        sketch.increment(hash(key));
+        if(auto *__p = map.find_pre(key).next_data()) {
+            ++hit;
+            const entry &__e = __p->second;
+            const size_t __n = v.size();
+            v.resize(__n + __e.size);
+            memcpy(v.data() + __n,__e.data,__e.size * sizeof(value_t));
+            return;
+        }
+        ++miss;
+        const size_t __n = v.size();
+        t.find(key,v);
+        if(v.size() != __n) admit(key,v.data() + __n,v.size() - __n);
+    }
+
+    /* Drop the cached values of a key , if any. */
+    void invalidate(const key_t &key) {
+        auto *__p = map.find_pre(key).next_data();
+        if(!__p) return;
+        entry __e = __p->second;
+        map.erase(key);
+        release(__e);
+    }
+
+    /* Drop all cached values. */
+    void clear() {
+        for(auto __i = map.begin() ; __i != map.end() ; ++__i) release(__i->second);
+        map.clear();
+    }
+
+    /* The tree behind the cache. */
+    tree_t &base() noexcept { return t; }
+
+    /* Count of cached keys. */
+    size_t size()  const noexcept { return map.size(); }
+    /* Bytes charged to cached keys. */
+    size_t bytes() const noexcept { return used; }
+    /* Finds served by the cache. */
+    size_t hits()   const noexcept { return hit; }
+    /* Finds served by the tree. */
+    size_t misses() const noexcept { return miss; }
+};
+
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 
 #include "utility.h"
+#include "storage.h"
 #include "Dark/trivial_array"
 
 namespace dark {
@@ -10,41 +11,39 @@ namespace dark {
 /**
  * @brief A rubbish bin for file management.
  * 
+ * @tparam storage_t Storage backend of the bin file.
  */
+template <class storage_t = file_storage>
 class rubbish_bin {
   private:
-    std::fstream bin_file; /* First 16 Byte : total and count. Then data array. */
+    storage_t bin_file; /* First 16 Byte : total and count. Then data array. */
     size_t total; /* Count of nodes. */
-    trivial_array <int> bin_array;  /* Cache of unused nodes. */
+    trivial_array <int,tagged_allocator <int,tag::free_list>> bin_array; /* Cache of unused nodes. */
 
   public:
 
     /* Initialize rubbish bin. */
-    rubbish_bin(std::string __bin) noexcept :
-        bin_file(__bin,std::ios::in | std::ios::out | std::ios::binary) {
-        if(!bin_file.good()) {
-            bin_file.close(); bin_file.open(__bin,std::ios::out | std::ios::binary);
-            std::pair <size_t,size_t> buffer(0,0);
-            bin_file.write((char *)&buffer,sizeof(buffer));
+    rubbish_bin(std::string __bin) noexcept {
+        std::pair <size_t,size_t> buffer(0,0);
+        if(!bin_file.open(__bin)) {
+            bin_file.write(&buffer,0,sizeof(buffer));
             total = 0;
         } else {
             /* Read to buffer. */
-            std::pair <size_t,size_t> buffer;
-            bin_file.read((char *)&buffer,sizeof(buffer));
+            bin_file.read(&buffer,0,sizeof(buffer));
 
             /* Update info. */
             total = buffer.first;
             bin_array.resize(buffer.second);
-            bin_file.read((char *)bin_array.data(),buffer.second * sizeof(int));
+            bin_file.read(bin_array.data(),sizeof(buffer),buffer.second * sizeof(int));
         }
     }
 
     /* Write bin data to disk. */
     ~rubbish_bin() {
         std::pair <size_t,size_t> buffer(total,bin_array.size());
-        bin_file.seekp(0);
-        bin_file.write((char *)&buffer,sizeof(buffer));
-        bin_file.write((char *)bin_array.data(),buffer.second * sizeof(int));
+        bin_file.write(&buffer,0,sizeof(buffer));
+        bin_file.write(bin_array.data(),sizeof(buffer),buffer.second * sizeof(int));
         bin_file.close();
     }
 
@@ -54,12 +53,29 @@ class rubbish_bin {
         else return total++;
     }
 
+    /* Allocate __n contiguous new indexes. Return the first. */
+    int allocate_range(size_t __n) {
+        int first = total;
+        total += __n;
+        return first;
+    }
+
     /* Recyle one index. */
     void recycle(int index) { bin_array.push_back(index); }
 
+    /* Recyle indexes in [first,last) at once. */
+    void recycle(const int *first,const int *last) {
+        size_t __n = bin_array.size();
+        bin_array.resize(__n + (last - first));
+        memcpy(bin_array.data() + __n,first,(last - first) * sizeof(int));
+    }
+
     /* Return count of all nodes. */
     size_t size() const noexcept { return total; }
 
+    /* Return count of recycled nodes. */
+    size_t free_size() const noexcept { return bin_array.size(); }
+
     /* Skip the last block. Only use it when first initializing. */
     void skip_block() { ++total; }
 };
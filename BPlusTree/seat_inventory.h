@@ -0,0 +1,168 @@
+#ifndef _DARK_SEAT_INVENTORY_H_
+#define _DARK_SEAT_INVENTORY_H_
+
+#include "file_manager.h"
+
+#include <climits>
+#include <algorithm>
+
+namespace dark {
+
+/**
+ * @brief Persistent free-seat counts of trains , by date and segment.
+ * Every (train,date) owns one slot: a contiguous array of free seats
+ * of each segment (between station i and i + 1). Slots never straddle
+ * a page , so a query or reservation reads one page , and dirties only
+ * the sectors of the segments it changes.
+ *
+ * Range min and range add are plain loops over contiguous ints ,
+ * which the compiler vectorizes. With at most 100 stations this is
+ * faster than any lazy tree over the same data.
+ *
+ * Slots of a train are allocated once as a contiguous range ,
+ * so slot of (train,date) is base + date.
+ *
+ * @tparam kSEGMENTS Maximum segments of a train (stations - 1).
+ */
+template <int kSEGMENTS = 99>
+class seat_inventory {
+  private:
+    /* Segments per slot , padded to a 64-byte line. */
+    static constexpr int kWIDTH = (kSEGMENTS + 15) / 16 * 16;
+
+    struct slot { int seat[kWIDTH]; };
+
+    /* Slots per page. */
+    static constexpr int kSLOTS = 4096 / sizeof(slot);
+    static_assert(kSLOTS > 0,"Too many segments!");
+
+    struct page { slot data[kSLOTS]; };
+
+    rubbish_bin <> slots; /* Count of slots allocated. */
+    cached_file_manager <page,1031,256> pages;
+
+    /* Visitor of the page holding a slot. */
+    auto locate(int id) { return pages.get_object(id / kSLOTS); }
+
+    /* Byte offset of segment i of a slot in its page. */
+    static size_t offset(int id,int i) noexcept
+    { return (id % kSLOTS) * sizeof(slot) + i * sizeof(int); }
+
+    static int range_min(const int *__restrict __p,int from,int to) noexcept {
+        int __m = INT_MAX;
+        for(int i = from ; i < to ; ++i) __m = std::min(__m,__p[i]);
+        return __m;
+    }
+
+    static void range_add(int *__restrict __p,int from,int to,int delta) noexcept
+    { for(int i = from ; i < to ; ++i) __p[i] += delta; }
+
+  public:
+
+    /* A reservation of count seats over segments [from,to) of a slot. */
+    struct request {
+        int  id;    /* Slot of (train,date). */
+        int  from;  /* First segment. */
+        int  to;    /* One past the last segment. */
+        int  count; /* Seats wanted. */
+        int  free;  /* Output: free seats over [from,to) before reserving. */
+        bool done;  /* Output: whether reserved. */
+    };
+
+    /* Open the inventory with files at path. */
+    explicit seat_inventory(const std::string &path) :
+        slots(path + ".slot"),pages(path + ".seat",path + ".bin") {}
+
+    seat_inventory(const seat_inventory &) = delete;
+
+
+    /**
+     * @brief Allocate slots of a train for count dates ,
+     * each with seats free on all segments.
+     *
+     * @return Slot of the first date.
+     */
+    int add_train(int count,int segments,int seats) {
+        int base = slots.allocate_range(count);
+        while(pages.size() * kSLOTS < size_t(base + count)) pages.allocate();
+        for(int id = base ; id != base + count ; ++id) {
+            auto pointer = locate(id);
+            int *__p = pointer->data[id % kSLOTS].seat;
+            std::fill(__p,__p + segments,seats);
+            std::fill(__p + segments,__p + kWIDTH,0);
+            pointer.modify_range(offset(id,0),sizeof(slot));
+        } return base;
+    }
+
+
+    /* Minimum free seats over segments [from,to) of a slot. */
+    int query(int id,int from,int to) {
+        return range_min(locate(id)->data[id % kSLOTS].seat,from,to);
+    }
+
+    /* Copy free seats of segments [from,to) of a slot to dst. */
+    void seats(int id,int from,int to,int *dst) {
+        const int *__p = locate(id)->data[id % kSLOTS].seat;
+        std::copy(__p + from,__p + to,dst);
+    }
+
+    /* Add delta free seats over segments [from,to) of a slot. */
+    void add(int id,int from,int to,int delta) {
+        auto pointer = locate(id);
+        range_add(pointer->data[id % kSLOTS].seat,from,to,delta);
+        pointer.modify_range(offset(id,from),(to - from) * sizeof(int));
+    }
+
+
+    /**
+     * @brief Reserve if there are enough free seats.
+     *
+     * @return Free seats over [from,to) before reserving.
+     */
+    int reserve(int id,int from,int to,int count) {
+        auto pointer = locate(id);
+        int *__p = pointer->data[id % kSLOTS].seat;
+        int free = range_min(__p,from,to);
+        if(free >= count) {
+            range_add(__p,from,to,-count);
+            pointer.modify_range(offset(id,from),(to - from) * sizeof(int));
+        } return free;
+    }
+
+
+    /**
+     * @brief Reserve a batch of requests.
+     * Requests are grouped by page , so each page is visited once.
+     * Requests on one slot are served in the given order.
+     */
+    void reserve(request *first,request *last) {
+        trivial_array <request *> order;
+        order.reserve(last - first);
+        for(request *__r = first ; __r != last ; ++__r) order.push_back(__r);
+        std::stable_sort(order.data(),order.data() + order.size(),
+            [](const request *x,const request *y) { return x->id / kSLOTS < y->id / kSLOTS; });
+
+        for(size_t i = 0 ; i != order.size() ;) {
+            auto pointer = locate(order[i]->id);
+            const int index = order[i]->id / kSLOTS;
+            for(; i != order.size() && order[i]->id / kSLOTS == index ; ++i) {
+                request &__r = *order[i];
+                int *__p = pointer->data[__r.id % kSLOTS].seat;
+                __r.free = range_min(__p,__r.from,__r.to);
+                __r.done = __r.free >= __r.count;
+                if(!__r.done) continue;
+                range_add(__p,__r.from,__r.to,-__r.count);
+                pointer.modify_range(offset(__r.id,__r.from),(__r.to - __r.from) * sizeof(int));
+            }
+        }
+    }
+
+
+    /* Count of slots. */
+    size_t size() const noexcept { return slots.size(); }
+};
+
+
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "bplus.h"
+#include "command.h"
+
+#include <cerrno>
+#include <cctype>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/**
+ * Serve commands over a Unix domain socket , keeping the tree open.
+ * Usage: server [--socket path] [--dir path]
+ *
+ * --socket : path of the socket. (bookstore.sock by default)
+ * --dir    : directory of index files. (output by default)
+ *
+ * Protocol is that of code , one command per line:
+ *      insert key value / delete key value / find key
+ * Only find has a response , which is one line in the format of code.
+ * Lines starting with a digit (the command count of code) are ignored,
+ * so an input file of code can be sent as it is.
+ *
+ * Requests can be pipelined. All complete lines received at once are
+ * executed in order and their responses are sent in one write.
+ * SIGINT / SIGTERM stops the server and writes the tree back.
+ */
+
+namespace {
+
+using tree   = dark::bpt <size_t,int,1023,10000,2>;
+using buffer = dark::trivial_array <char>;
+
+constexpr size_t kREAD   = 1 << 16; /* Bytes read per event. */
+constexpr size_t kHIGH   = 1 << 22; /* Pending output to stop reading. */
+constexpr int    kEVENTS = 64;      /* Events per epoll_wait. */
+
+volatile sig_atomic_t stop = 0;
+void on_signal(int) { stop = 1; }
+
+/* State of one connection. */
+struct client {
+    int    fd;
+    buffer in;   /* Received bytes , not a complete line yet. */
+    buffer out;  /* Responses not sent yet. */
+    size_t sent; /* Bytes of out already sent. */
+    bool   eof;  /* Peer has shut down its writing side. */
+};
+
+class server {
+  private:
+    int  epfd;   /* epoll instance. */
+    int  listen_fd;
+    tree &t;
+    typename tree::return_list data;
+
+    void watch(int op,int fd,uint32_t events,void *ptr) {
+        epoll_event ev;
+        ev.events   = events;
+        ev.data.ptr = ptr;
+        epoll_ctl(epfd,op,fd,&ev);
+    }
+
+    /* Events wanted by the client given its buffers. */
+    static uint32_t interest(const client &c) {
+        uint32_t events = 0;
+        if(!c.eof && c.out.size() - c.sent < kHIGH) events |= EPOLLIN;
+        if(c.sent != c.out.size()) events |= EPOLLOUT;
+        return events;
+    }
+
+    void accept_all() {
+        int fd;
+        while((fd = accept4(listen_fd,nullptr,nullptr,SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+            client *c = new client {fd,{},{},0,false};
+            watch(EPOLL_CTL_ADD,fd,EPOLLIN,c);
+        }
+    }
+
+    void drop(client *c) {
+        epoll_ctl(epfd,EPOLL_CTL_DEL,c->fd,nullptr);
+        ::close(c->fd);
+        delete c;
+    }
+
+    /* Run one line in place and append its response to out. */
+    void execute(char *line,buffer &out) {
+        char *token[3] = {};
+        for(int i = 0 ; i != 3 ; ++i) {
+            while(*line == ' ' || *line == '\t' || *line == '\r') ++line;
+            if(!*line) break;
+            token[i] = line;
+            while(*line && *line != ' ' && *line != '\t' && *line != '\r') ++line;
+            if(*line) *line++ = '\0';
+        }
+        if(!token[0] || !token[1] || isdigit(*token[0])) return;
+        char op = token[0][0];
+        int val = (op == 'i' || op == 'd') && token[2] ? atoi(token[2]) : 0;
+        data.clear();
+        if(dark::execute_command(t,op,token[1],val,data))
+            dark::format_result(data,out);
+    }
+
+    /* Execute all complete lines in the input buffer. */
+    void process(client *c) {
+        size_t last = c->in.size();
+        while(last && c->in[last - 1] != '\n') --last;
+        if(c->eof && last != c->in.size()) { /* The last line has no '\n'. */
+            c->in.push_back('\n');
+            last = c->in.size();
+        }
+        if(!last) return;
+
+        char *__p = c->in.data(),*__e = __p + last;
+        while(__p != __e) {
+            char *__n = (char *)memchr(__p,'\n',__e - __p);
+            *__n = '\0';
+            execute(__p,c->out);
+            __p = __n + 1;
+        }
+        size_t rest = c->in.size() - last;
+        memmove(c->in.data(),c->in.data() + last,rest);
+        c->in.resize(rest);
+    }
+
+    /* Read what is available. Return false if the client is gone. */
+    bool on_read(client *c) {
+        size_t size = c->in.size();
+        c->in.resize(size + kREAD);
+        ssize_t __n = ::read(c->fd,c->in.data() + size,kREAD);
+        c->in.resize(size + (__n > 0 ? __n : 0));
+        if(__n == 0) c->eof = true;
+        else if(__n < 0) return errno == EAGAIN || errno == EINTR;
+        process(c);
+        return true;
+    }
+
+    /* Send pending responses. Return false if the client is gone. */
+    bool on_write(client *c) {
+        while(c->sent != c->out.size()) {
+            ssize_t __n = ::send(c->fd,c->out.data() + c->sent,
+                                 c->out.size() - c->sent,MSG_NOSIGNAL);
+            if(__n < 0) return errno == EAGAIN || errno == EINTR;
+            c->sent += __n;
+        }
+        c->out.clear();
+        c->sent = 0;
+        return true;
+    }
+
+  public:
+
+    server(tree &__t) : epfd(-1),listen_fd(-1),t(__t) {}
+
+    ~server() {
+        if(listen_fd != -1) ::close(listen_fd);
+        if(epfd != -1) ::close(epfd);
+    }
+
+    /* Listen on given path. Return whether it succeeds. */
+    bool listen(const char *path) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if(strlen(path) >= sizeof(addr.sun_path)) return false;
+        strcpy(addr.sun_path,path);
+        unlink(path);
+
+        listen_fd = socket(AF_UNIX,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+        if(listen_fd == -1) return false;
+        if(bind(listen_fd,(sockaddr *)&addr,sizeof(addr))) return false;
+        if(::listen(listen_fd,SOMAXCONN)) return false;
+
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        if(epfd == -1) return false;
+        watch(EPOLL_CTL_ADD,listen_fd,EPOLLIN,nullptr);
+        return true;
+    }
+
+    /* Serve until stopped by a signal. */
+    void run() {
+        epoll_event events[kEVENTS];
+        while(!stop) {
+            int count = epoll_wait(epfd,events,kEVENTS,-1);
+            for(int i = 0 ; i < count ; ++i) {
+                client *c = (client *)events[i].data.ptr;
+                if(!c) { accept_all(); continue; }
+
+                bool alive = true;
+                if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) alive = on_read(c);
+                if(alive) alive = on_write(c);
+                if(alive && !(c->eof && c->out.empty() && c->in.empty()))
+                    watch(EPOLL_CTL_MOD,c->fd,interest(*c),c);
+                else drop(c);
+            }
+        }
+    }
+};
+
+}
+
+
+signed main(int argc,char **argv) {
+    const char *socket_path = "bookstore.sock";
+    const char *dir         = "output";
+    for(int i = 1 ; i < argc ; ++i) {
+        if     (!strcmp(argv[i],"--socket") && i + 1 < argc) socket_path = argv[++i];
+        else if(!strcmp(argv[i],"--dir")    && i + 1 < argc) dir         = argv[++i];
+        else {
+            fprintf(stderr,"Usage: %s [--socket path] [--dir path]\n",argv[0]);
+            return 1;
+        }
+    }
+
+    struct sigaction act = {};
+    act.sa_handler = on_signal;
+    sigaction(SIGINT ,&act,nullptr);
+    sigaction(SIGTERM,&act,nullptr);
+    signal(SIGPIPE,SIG_IGN);
+
+    std::filesystem::create_directory(dir);
+    tree t(std::string(dir) + "/a");
+    server s(t);
+    if(!s.listen(socket_path)) {
+        fprintf(stderr,"Cannot listen on %s : %s\n",socket_path,strerror(errno));
+        return 1;
+    }
+    s.run();
+    unlink(socket_path);
+    return 0;
+}
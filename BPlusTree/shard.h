@@ -0,0 +1,190 @@
+#ifndef _DARK_SHARD_H_
+#define _DARK_SHARD_H_
+
+#include "pipeline.h"
+
+#include <memory>
+#include <vector>
+#include <string>
+
+namespace dark {
+
+/**
+ * @brief Front end over independent trees , partitioned by key hash.
+ * Every shard has its own files , cache and worker thread.
+ * A command goes to shard key % count , so commands on one key
+ * run in input order. Results are merged back into input order.
+ *
+ * The shard count is saved in path.shards on first use , and an
+ * index directory always reopens with the saved count.
+ *
+ * @tparam tree_t Type of each shard.
+ */
+template <class tree_t>
+class sharded {
+  private:
+    static constexpr size_t kBATCH = 1024;    /* Commands per batch. */
+    static constexpr size_t kDEPTH = 8;       /* Batches in flight. */
+    static constexpr size_t kFLUSH = 1 << 16; /* Output bytes per write. */
+
+    /* Results of one shard in a batch. */
+    struct part {
+        typename tree_t::return_list value; /* Results of its finds. */
+        trivial_array <size_t>       end;   /* End of each find result in value. */
+    };
+
+    struct batch {
+        trivial_array <command>  cmd;   /* Commands in order. */
+        std::unique_ptr <part[]> parts; /* Results by shard. */
+    };
+
+    using queue_t = spsc_queue <batch *,kDEPTH>;
+
+    std::vector <std::unique_ptr <tree_t>> trees;
+
+    /* Read the saved shard count , or save the given one. */
+    static size_t load_count(const std::string &path,size_t count) {
+        FILE *file = fopen((path + ".shards").c_str(),"r");
+        size_t saved = 0;
+        if(file) {
+            if(fscanf(file,"%zu",&saved) != 1) saved = 0;
+            fclose(file);
+        }
+        if(saved) {
+            if(saved != count)
+                fprintf(stderr,"Index %s has %zu shards. Using it instead of %zu.\n",
+                        path.c_str(),saved,count);
+            return saved;
+        }
+        if((file = fopen((path + ".shards").c_str(),"w"))) {
+            fprintf(file,"%zu\n",count);
+            fclose(file);
+        } return count;
+    }
+
+    /* Execute commands of shard i in a batch. */
+    void execute(size_t i,batch &b) {
+        tree_t &t = *trees[i];
+        part   &p = b.parts[i];
+        p.value.clear();
+        p.end.clear();
+        for(const command &c : b.cmd) {
+            if(route(c.key) != i) continue;
+            if(c.op == 'i' || c.op == 'd') {
+                if constexpr (!tree_t::read_only) {
+                    if(c.op == 'i') t.insert(c.key,c.val);
+                    else            t.erase (c.key,c.val);
+                }
+            } else {
+                t.find(c.key,p.value);
+                p.end.push_back(p.value.size());
+            }
+        }
+    }
+
+    /* Merge results of a batch in input order. */
+    template <class buffer_t>
+    void format(const batch &b,trivial_array <size_t> &cursor,buffer_t &buf) {
+        cursor.resize(size(),nullptr);
+        memset(cursor.data(),0,size() * sizeof(size_t));
+        for(const command &c : b.cmd) {
+            if(c.op == 'i' || c.op == 'd') continue;
+            size_t i = route(c.key);
+            const part &p = b.parts[i];
+            size_t first = cursor[i] ? p.end[cursor[i] - 1] : 0;
+            size_t last  = p.end[cursor[i]++];
+            format_result(p.value.data() + first,p.value.data() + last,buf);
+        }
+    }
+
+  public:
+
+    /**
+     * @brief Open count shards at path.0 , path.1 ...
+     *
+     * @param path  Path prefix of the index.
+     * @param count Shard count if the index is new.
+     */
+    sharded(const std::string &path,size_t count) {
+        count = load_count(path,count ? count : 1);
+        trees.reserve(count);
+        for(size_t i = 0 ; i != count ; ++i)
+            trees.emplace_back(new tree_t(path + '.' + std::to_string(i)));
+    }
+
+    /* Count of shards. */
+    size_t size() const noexcept { return trees.size(); }
+
+    /* Shard of given index. */
+    tree_t &shard(size_t i) noexcept { return *trees[i]; }
+
+    /* Shard index of a key. */
+    size_t route(size_t key) const noexcept { return key % trees.size(); }
+
+    /**
+     * @brief Run commands until parse returns false.
+     * The calling thread parses , every shard has a worker ,
+     * and one more thread merges and formats the results.
+     *
+     * @param parse Fill the next command. Return whether there is one.
+     * @param out   File for results of find.
+     */
+    template <class parse_func>
+    void run(parse_func &&parse,FILE *out) {
+        const size_t count = size();
+        batch pool[kDEPTH];
+        queue_t free_queue; /* Formatter -> parser. */
+        std::unique_ptr <queue_t[]> todo(new queue_t[count]); /* Parser -> shard. */
+        std::unique_ptr <queue_t[]> done(new queue_t[count]); /* Shard  -> formatter. */
+        for(batch &b : pool) {
+            b.parts.reset(new part[count]);
+            free_queue.push(&b);
+        }
+
+        std::vector <std::thread> workers;
+        for(size_t i = 0 ; i != count ; ++i) {
+            workers.emplace_back([&,i] {
+                for(batch *b ; (b = todo[i].pop()) ;) {
+                    execute(i,*b);
+                    done[i].push(b);
+                } done[i].push(nullptr);
+            });
+        }
+
+        /* Every shard hands over the same batches in the same order. */
+        std::thread formatter([&] {
+            trivial_array <char>   buf;
+            trivial_array <size_t> cursor;
+            for(;;) {
+                batch *b = done[0].pop();
+                for(size_t i = 1 ; i != count ; ++i) done[i].pop();
+                if(!b) break;
+                format(*b,cursor,buf);
+                free_queue.push(b);
+                if(buf.size() >= kFLUSH) {
+                    fwrite(buf.data(),1,buf.size(),out);
+                    buf.clear();
+                }
+            }
+            fwrite(buf.data(),1,buf.size(),out);
+            fflush(out);
+        });
+
+        command c;
+        for(bool more = true ; more ;) {
+            batch *b = free_queue.pop();
+            b->cmd.clear();
+            while(b->cmd.size() != kBATCH && (more = parse(c))) b->cmd.copy_back(c);
+            for(size_t i = 0 ; i != count ; ++i) todo[i].push(b);
+        }
+        for(size_t i = 0 ; i != count ; ++i) todo[i].push(nullptr);
+
+        for(auto &w : workers) w.join();
+        formatter.join();
+    }
+};
+
+
+}
+
+#endif
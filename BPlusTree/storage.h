@@ -0,0 +1,290 @@
+#ifndef _DARK_STORAGE_H_
+#define _DARK_STORAGE_H_
+
+#include "utility.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+namespace dark {
+
+
+/**
+ * @brief Storage backed by a real file.
+ * Using positional IO , so concurrent reads are safe.
+ *
+ */
+class file_storage {
+  private:
+    int fd; /* File descriptor. */
+
+  public:
+
+    static constexpr bool read_only = false;
+
+    file_storage() noexcept : fd(-1) {}
+    file_storage(const file_storage &) = delete;
+    ~file_storage() { close(); }
+
+    /**
+     * @brief Open a file. Create it if missing.
+     *
+     * @param path Path of the file.
+     * @return Whether there has been data in the file.
+     */
+    bool open(const std::string &path) {
+        close();
+        fd = ::open(path.c_str(),O_RDWR | O_CREAT,0644);
+        return size();
+    }
+
+    /* Close the file if opened. */
+    void close() noexcept { if(fd != -1) ::close(fd),fd = -1; }
+
+    /* Read len bytes at pos. Bytes beyond the end of file are filled with 0. */
+    void read(void *buf,size_t pos,size_t len) {
+        char *__p = (char *)buf;
+        while(len) {
+            ssize_t __n = ::pread(fd,__p,len,pos);
+            if(__n <= 0) { memset(__p,0,len); return; }
+            __p += __n; pos += __n; len -= __n;
+        }
+    }
+
+    /* Write len bytes at pos. */
+    void write(const void *buf,size_t pos,size_t len) {
+        const char *__p = (const char *)buf;
+        while(len) {
+            ssize_t __n = ::pwrite(fd,__p,len,pos);
+            if(__n <= 0) return;
+            __p += __n; pos += __n; len -= __n;
+        }
+    }
+
+    /* Size of the file in bytes. */
+    size_t size() const noexcept {
+        struct stat __s;
+        return fd != -1 && !fstat(fd,&__s) ? __s.st_size : 0;
+    }
+
+    /* Hint the kernel to read [pos,pos + len) ahead. */
+    void will_need(size_t pos,size_t len) const noexcept {
+        if(fd != -1) posix_fadvise(fd,pos,len,POSIX_FADV_WILLNEED);
+    }
+};
+
+
+/**
+ * @brief Read-only storage mapped into memory.
+ * The file is never created nor written. Pages are shared with
+ * other processes mapping the same file through the page cache.
+ *
+ */
+class mapped_storage {
+  private:
+    static constexpr size_t kPAGE = 4096;
+
+    char  *base;   /* Start of the mapping. */
+    size_t length; /* Length of the file. */
+
+  public:
+
+    static constexpr bool read_only = true;
+
+    mapped_storage() noexcept : base(nullptr),length(0) {}
+    mapped_storage(const mapped_storage &) = delete;
+    ~mapped_storage() { close(); }
+
+    /**
+     * @brief Map an existing file.
+     *
+     * @param path Path of the file.
+     * @return Whether there has been data in the file.
+     */
+    bool open(const std::string &path) {
+        close();
+        int fd = ::open(path.c_str(),O_RDONLY);
+        if(fd == -1) return false;
+        struct stat __s;
+        if(!fstat(fd,&__s) && __s.st_size) {
+            void *__p = mmap(nullptr,__s.st_size,PROT_READ,MAP_SHARED,fd,0);
+            if(__p != MAP_FAILED) base = (char *)__p,length = __s.st_size;
+        }
+        ::close(fd); /* The mapping keeps the file. */
+        return length;
+    }
+
+    /* Unmap the file if mapped. */
+    void close() noexcept {
+        if(base) munmap(base,length);
+        base = nullptr; length = 0;
+    }
+
+    /* Read len bytes at pos. Bytes beyond the end of file are filled with 0. */
+    void read(void *buf,size_t pos,size_t len) const noexcept {
+        size_t __n = pos < length ? std::min(len,length - pos) : 0;
+        if(__n) memcpy(buf,base + pos,__n);
+        memset((char *)buf + __n,0,len - __n);
+    }
+
+    /* Start of the mapping. */
+    const char *data() const noexcept { return base; }
+
+    /* Size of the file in bytes. */
+    size_t size() const noexcept { return length; }
+
+    /* Hint the kernel to read [pos,pos + len) ahead. */
+    void will_need(size_t pos,size_t len) const noexcept {
+        if(pos >= length) return;
+        len = std::min(len,length - pos) + pos % kPAGE;
+        madvise(base + pos / kPAGE * kPAGE,len,MADV_WILLNEED);
+    }
+};
+
+
+/* IO statistics of a storage. A block is 4 KiB. */
+struct io_stats {
+    size_t reads;        /* Count of read calls. */
+    size_t writes;       /* Count of write calls. */
+    size_t read_bytes;   /* Bytes read. */
+    size_t write_bytes;  /* Bytes written. */
+    size_t read_blocks;  /* 4 KiB blocks touched by reads. */
+    size_t write_blocks; /* 4 KiB blocks touched by writes. */
+    size_t sequential;   /* Accesses starting where the last one ended. */
+    size_t random;       /* Accesses that need a seek. */
+
+    /* Count of seeks , which is exactly count of random accesses. */
+    size_t seeks() const noexcept { return random; }
+};
+
+
+/**
+ * @brief Storage kept in memory , which counts every access.
+ * Files are kept in a process-wide table by path ,
+ * so reopening a path sees the data written before.
+ * Used for deterministic IO regression tests.
+ *
+ */
+class memory_storage {
+  private:
+    static constexpr size_t kBLOCK = 4096;
+
+    std::string *data; /* Content of the file. */
+    std::mutex   lock; /* Concurrent access guard. */
+    io_stats     stat; /* Statistics. */
+    size_t       last; /* End position of last access. */
+
+    std::chrono::nanoseconds seek_cost;  /* Simulated latency of a seek. */
+    std::chrono::nanoseconds block_cost; /* Simulated latency of a block. */
+
+    /* All files in memory. */
+    static std::map <std::string,std::string> &table() {
+        static std::map <std::string,std::string> __t;
+        return __t;
+    }
+
+    /* Count one access and return the simulated latency of it. */
+    std::chrono::nanoseconds account(size_t pos,size_t len,bool is_write) {
+        size_t blocks = len ? (pos + len - 1) / kBLOCK - pos / kBLOCK + 1 : 0;
+        bool   seek   = pos != last;
+        last = pos + len;
+        if(seek) ++stat.random;
+        else     ++stat.sequential;
+        if(is_write) ++stat.writes,stat.write_bytes += len,stat.write_blocks += blocks;
+        else         ++stat.reads ,stat.read_bytes  += len,stat.read_blocks  += blocks;
+        return (seek ? seek_cost : std::chrono::nanoseconds(0)) + block_cost * blocks;
+    }
+
+    /* Wait for simulated latency outside the lock. */
+    static void delay(std::chrono::nanoseconds __t) {
+        if(__t.count()) std::this_thread::sleep_for(__t);
+    }
+
+  public:
+
+    static constexpr bool read_only = false;
+
+    memory_storage() noexcept :
+        data(nullptr),stat(),last(0),seek_cost(0),block_cost(0) {}
+    memory_storage(const memory_storage &) = delete;
+    ~memory_storage() = default;
+
+    /**
+     * @brief Open a file in memory. Create it if missing.
+     *
+     * @param path Path of the file.
+     * @return Whether there has been data in the file.
+     */
+    bool open(const std::string &path) {
+        std::lock_guard <std::mutex> guard(lock);
+        data = &table()[path];
+        return !data->empty();
+    }
+
+    /* Nothing to do. */
+    void close() noexcept {}
+
+    /* Read len bytes at pos. Bytes beyond the end of file are filled with 0. */
+    void read(void *buf,size_t pos,size_t len) {
+        std::chrono::nanoseconds __t;
+        {
+            std::lock_guard <std::mutex> guard(lock);
+            __t = account(pos,len,false);
+            size_t __n = pos < data->size() ? std::min(len,data->size() - pos) : 0;
+            if(__n) memcpy(buf,data->data() + pos,__n);
+            memset((char *)buf + __n,0,len - __n);
+        } delay(__t);
+    }
+
+    /* Write len bytes at pos. */
+    void write(const void *buf,size_t pos,size_t len) {
+        std::chrono::nanoseconds __t;
+        {
+            std::lock_guard <std::mutex> guard(lock);
+            __t = account(pos,len,true);
+            if(data->size() < pos + len) data->resize(pos + len);
+            memcpy(&(*data)[pos],buf,len);
+        } delay(__t);
+    }
+
+    /* Size of the file in bytes. */
+    size_t size() const noexcept { return data ? data->size() : 0; }
+
+    /* Nothing to read ahead in memory. */
+    void will_need(size_t,size_t) const noexcept {}
+
+    /**
+     * @brief Inject simulated latency into every access.
+     *
+     * @param seek  Latency of an access that needs a seek.
+     * @param block Latency of every 4 KiB block touched.
+     */
+    void set_latency(std::chrono::nanoseconds seek,std::chrono::nanoseconds block)
+    noexcept { seek_cost = seek; block_cost = block; }
+
+    /* Statistics since opened or last reset. */
+    io_stats stats() const noexcept { return stat; }
+
+    /* Reset the statistics. */
+    void reset_stats() noexcept { stat = io_stats(); }
+
+    /* Remove a file from memory. */
+    static void remove(const std::string &path) { table().erase(path); }
+
+    /* Remove all files from memory. */
+    static void clear() { table().clear(); }
+};
+
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef _DARK_TABLE_H_
+#define _DARK_TABLE_H_
+
+#include "bplus.h"
+
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+namespace dark {
+
+/**
+ * @brief Table of fixed-size records with B+ tree indexes.
+ * Records live in slots of cached pages , and a record id is its slot.
+ * The primary tree maps primary key to record id , and each secondary
+ * tree maps its key to ids of all records with that key.
+ * Every index is kept in sync on insert , update and erase , and an
+ * update only touches the trees whose key changed.
+ *
+ * A key is described by a type like:
+ *      struct by_name {
+ *          using key_type = string <24>;
+ *          static key_type get(const user &x) { return x.name; }
+ *      };
+ * key_type should be comparable by < and hashable by std::hash.
+ *
+ * Files are path.rec / path.slot for records , and path.pk ,
+ * path.sk0 , path.sk1 ... for indexes.
+ *
+ * @tparam Record        Trivially copyable record type.
+ * @tparam PrimaryKey    Primary key , unique in the table.
+ * @tparam SecondaryKeys Secondary keys , which may be duplicated.
+ */
+template <class Record,class PrimaryKey,class ...SecondaryKeys>
+class table {
+  private:
+    static_assert(std::is_trivially_copyable_v <Record>,"Record must be trivially copyable!");
+
+    /* Records per page. */
+    static constexpr int kSLOTS = sizeof(Record) < 4096 ? 4096 / sizeof(Record) : 1;
+
+    struct page { Record data[kSLOTS]; };
+
+    template <class key_desc>
+    using index_t = bpt <typename key_desc::key_type,int,1023,256,2>;
+
+    using primary_t   = index_t <PrimaryKey>;
+    using secondary_t = std::tuple <index_t <SecondaryKeys>...>;
+    using pk_type     = typename PrimaryKey::key_type;
+
+    static constexpr size_t kINDEX = sizeof...(SecondaryKeys);
+
+    template <size_t I>
+    using key_desc_of = std::tuple_element_t <I,std::tuple <SecondaryKeys...>>;
+
+    rubbish_bin <> slots; /* Free record ids. */
+    cached_file_manager <page,1031,256> pages;
+    primary_t   primary;
+    secondary_t secondary;
+
+  public:
+    using id_list = typename primary_t::return_list;
+
+  private:
+
+    /* Whether two keys of a descriptor differ. */
+    template <class key_desc>
+    static bool changed(const Record &x,const Record &y)
+    { return Compare <typename key_desc::key_type> ()(key_desc::get(x),key_desc::get(y)) != 0; }
+
+    /* Visitor of the page holding record id. */
+    auto locate(int id) { return pages.get_object(id / kSLOTS); }
+
+    /* Write record id , dirtying only its sectors of the page. */
+    void write(int id,const Record &x) {
+        auto pointer = locate(id);
+        pointer->data[id % kSLOTS] = x;
+        pointer.modify_range((id % kSLOTS) * sizeof(Record),sizeof(Record));
+    }
+
+    /* Add id under every secondary key of x. */
+    template <size_t ...I>
+    void link(const Record &x,int id,std::index_sequence <I...>)
+    { (std::get <I> (secondary).insert(key_desc_of <I>::get(x),id),...); }
+
+    /* Remove id from every secondary key of x. */
+    template <size_t ...I>
+    void unlink(const Record &x,int id,std::index_sequence <I...>)
+    { (std::get <I> (secondary).erase(key_desc_of <I>::get(x),id),...); }
+
+    /* Move id between secondary keys , only for those changed. */
+    template <size_t ...I>
+    void relink(const Record &x,const Record &y,int id,std::index_sequence <I...>) {
+        ((changed <key_desc_of <I>> (x,y) ?
+            (std::get <I> (secondary).erase (key_desc_of <I>::get(x),id),
+             std::get <I> (secondary).insert(key_desc_of <I>::get(y),id)) : void()),...);
+    }
+
+    /**
+     * @brief Reindex record id from x to y.
+     *
+     * @return False if y takes a primary key of another record.
+     */
+    bool reindex(const Record &x,const Record &y,int id) {
+        if(changed <PrimaryKey> (x,y)) {
+            if(primary.contains(PrimaryKey::get(y))) return false;
+            primary.erase (PrimaryKey::get(x),id);
+            primary.insert(PrimaryKey::get(y),id);
+        }
+        relink(x,y,id,std::make_index_sequence <kINDEX> ());
+        return true;
+    }
+
+    template <size_t ...I>
+    table(const std::string &path,std::index_sequence <I...>) :
+        slots(path + ".slot"),
+        pages(path + ".rec",path + ".bin"),
+        primary(path + ".pk"),
+        secondary((path + ".sk" + std::to_string(I))...) {}
+
+  public:
+
+    /* Open the table with files at path. */
+    explicit table(const std::string &path) :
+        table(path,std::make_index_sequence <kINDEX> ()) {}
+
+    table(const table &) = delete;
+
+
+    /* Id of the record with primary key , or -1 if none. */
+    int id_of(const pk_type &key) {
+        int id;
+        return primary.first(key,id) ? id : -1;
+    }
+
+    /* Whether a record with primary key exists. */
+    bool contains(const pk_type &key) { return primary.contains(key); }
+
+    /* Read the record of given id. */
+    void get(int id,Record &x) { x = locate(id)->data[id % kSLOTS]; }
+
+    /* Read the record with primary key. Return whether found. */
+    bool find(const pk_type &key,Record &x) {
+        int id = id_of(key);
+        if(id < 0) return false;
+        get(id,x);
+        return true;
+    }
+
+    /**
+     * @brief Append ids of records with secondary key I to ids.
+     *
+     * @tparam I Index of the secondary key.
+     */
+    template <size_t I>
+    void find_by(const typename key_desc_of <I>::key_type &key,id_list &ids)
+    { std::get <I> (secondary).find(key,ids); }
+
+
+    /**
+     * @brief Insert a record.
+     *
+     * @return Id of the record , or -1 if the primary key exists.
+     */
+    int insert(const Record &x) {
+        if(primary.contains(PrimaryKey::get(x))) return -1;
+        int id = slots.allocate();
+        while(pages.size() <= size_t(id / kSLOTS)) pages.allocate();
+        write(id,x);
+        primary.insert(PrimaryKey::get(x),id);
+        link(x,id,std::make_index_sequence <kINDEX> ());
+        return id;
+    }
+
+
+    /**
+     * @brief Replace the record of given id.
+     * Only indexes whose key changed are touched.
+     *
+     * @return False if y takes a primary key of another record.
+     */
+    bool update(int id,const Record &y) {
+        Record x;
+        get(id,x);
+        if(!reindex(x,y,id)) return false;
+        write(id,y);
+        return true;
+    }
+
+
+    /* Replace the record of given id , as update. For generic stores. */
+    void set(int id,const Record &y) { update(id,y); }
+
+
+    /**
+     * @brief Modify the record with primary key in place by func(Record &).
+     * Only indexes whose key changed are touched.
+     *
+     * @return False if not found , or if the new primary key is taken.
+     * The record is left unchanged then.
+     */
+    template <class func_t>
+    bool modify(const pk_type &key,func_t &&func) {
+        int id = id_of(key);
+        if(id < 0) return false;
+        Record x,y;
+        get(id,x);
+        y = x;
+        func(y);
+        if(!reindex(x,y,id)) return false;
+        write(id,y);
+        return true;
+    }
+
+
+    /* Erase the record with primary key. Return whether found. */
+    bool erase(const pk_type &key) {
+        int id = id_of(key);
+        if(id < 0) return false;
+        Record x;
+        get(id,x);
+        primary.erase(key,id);
+        unlink(x,id,std::make_index_sequence <kINDEX> ());
+        slots.recycle(id);
+        return true;
+    }
+
+
+    /* Count of records. */
+    size_t size() const noexcept { return slots.size() - slots.free_size(); }
+};
+
+
+}
+
+#endif
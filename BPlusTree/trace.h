@@ -0,0 +1,178 @@
+#ifndef _DARK_TRACE_H_
+#define _DARK_TRACE_H_
+
+#include "utility.h"
+#include "Dark/trivial_array"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+namespace dark {
+
+/**
+ * Binary command trace.
+ * Header : 4 bytes magic "DKTR" , then 8 bytes of wall clock (us) at start.
+ * Record : varint time delta (us) , op char ,
+ *          varint key length , key bytes ,
+ *          zigzag varint value (insert / delete only).
+ */
+namespace trace {
+
+constexpr char   kMAGIC[4] = {'D','K','T','R'};
+constexpr size_t kBUFFER   = 1 << 16; /* Flush threshold of writer. */
+
+/* One command read from a trace. */
+struct entry {
+    uint64_t    time; /* Microseconds since start of recording. */
+    char        op;   /* 'i'nsert / 'd'elete / 'f'ind */
+    const char *key;  /* Null-terminated key. Valid until next read. */
+    int         val;  /* Value of insert / delete. */
+};
+
+
+/* Records commands into a trace file. */
+class writer {
+  private:
+    using clock = std::chrono::steady_clock;
+
+    FILE *file;                 /* Trace file. */
+    trivial_array <char,tagged_allocator <char,tag::trace>> buf; /* Pending bytes. */
+    clock::time_point start;    /* Time of first record. */
+    uint64_t last;              /* Time of last record in us. */
+
+    void put(char __c) { buf.push_back(__c); }
+
+    void put_varint(uint64_t __n) {
+        while(__n >= 0x80) { put(char(__n | 0x80)); __n >>= 7; }
+        put(char(__n));
+    }
+
+  public:
+
+    writer() noexcept : file(nullptr),last(0) {}
+    writer(const writer &) = delete;
+    ~writer() { close(); }
+
+    /* Open a new trace file. Return whether it succeeds. */
+    bool open(const char *path) {
+        close();
+        if(!(file = fopen(path,"wb"))) return false;
+        uint64_t wall = std::chrono::duration_cast <std::chrono::microseconds> (
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        fwrite(kMAGIC,1,sizeof(kMAGIC),file);
+        fwrite(&wall,1,sizeof(wall),file);
+        start = clock::now();
+        last  = 0;
+        return true;
+    }
+
+    /* Whether a trace is being recorded. */
+    bool is_open() const noexcept { return file; }
+
+    /* Record one command. */
+    void record(char op,const char *key,int val) {
+        uint64_t now = std::chrono::duration_cast <std::chrono::microseconds> (
+            clock::now() - start).count();
+        put_varint(now - last); last = now;
+        put(op);
+        size_t len = strlen(key);
+        put_varint(len);
+        while(*key) put(*key++);
+        if(op == 'i' || op == 'd') put_varint(uint64_t(int64_t(val) << 1 ^ int64_t(val) >> 63));
+        if(buf.size() >= kBUFFER) flush();
+    }
+
+    /* Write pending records to file. */
+    void flush() {
+        if(file && !buf.empty()) fwrite(buf.data(),1,buf.size(),file);
+        buf.clear();
+    }
+
+    /* Flush and close the file. */
+    void close() {
+        if(!file) return;
+        flush();
+        fclose(file);
+        file = nullptr;
+    }
+};
+
+
+/* Reads commands from a trace file. The whole file is loaded at open. */
+class reader {
+  private:
+    using array_t = trivial_array <char,tagged_allocator <char,tag::parser>>;
+
+    array_t  buf;             /* Whole file. */
+    array_t  key;             /* Key of current entry. */
+    size_t   pos;             /* Read position. */
+    uint64_t time;            /* Time of last entry. */
+
+    uint64_t get_varint() {
+        uint64_t __n = 0;
+        int shift = 0;
+        while(pos != buf.size()) {
+            unsigned char __c = buf[pos++];
+            __n |= uint64_t(__c & 0x7f) << shift;
+            if(!(__c & 0x80)) break;
+            shift += 7;
+        } return __n;
+    }
+
+  public:
+
+    reader() noexcept : pos(0),time(0) {}
+
+    /* Load a trace file. Return whether it is a valid trace. */
+    bool open(const char *path) {
+        FILE *file = fopen(path,"rb");
+        if(!file) return false;
+        fseek(file,0,SEEK_END);
+        buf.resize(ftell(file));
+        fseek(file,0,SEEK_SET);
+        size_t count = fread(buf.data(),1,buf.size(),file);
+        fclose(file);
+        if(count != buf.size() || count < sizeof(kMAGIC) + sizeof(uint64_t)) return false;
+        if(memcmp(buf.data(),kMAGIC,sizeof(kMAGIC))) return false;
+        rewind();
+        return true;
+    }
+
+    /* Restart from the first entry. */
+    void rewind() noexcept { pos = sizeof(kMAGIC) + sizeof(uint64_t); time = 0; }
+
+    /* Wall clock in us when the trace was started. */
+    uint64_t wall_time() const noexcept {
+        uint64_t wall;
+        memcpy(&wall,buf.data() + sizeof(kMAGIC),sizeof(wall));
+        return wall;
+    }
+
+    /* Read next entry. Return false at the end of trace. */
+    bool next(entry &e) {
+        if(pos >= buf.size()) return false;
+        e.time = (time += get_varint());
+        e.op   = buf[pos++];
+        size_t len = get_varint();
+        if(pos + len > buf.size()) return false; /* Truncated record. */
+        key.resize(len + 1);
+        memcpy(key.data(),buf.data() + pos,len);
+        key[len] = '\0';
+        pos  += len;
+        e.key = key.data();
+        if(e.op == 'i' || e.op == 'd') {
+            uint64_t __z = get_varint();
+            e.val = int(int64_t(__z >> 1) ^ -int64_t(__z & 1));
+        } else e.val = 0;
+        return true;
+    }
+};
+
+
+}
+
+}
+
+#endif
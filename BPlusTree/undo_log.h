@@ -0,0 +1,337 @@
+#ifndef _DARK_UNDO_LOG_H_
+#define _DARK_UNDO_LOG_H_
+
+#include "storage.h"
+#include "utility.h"
+#include "Dark/trivial_array"
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+namespace dark {
+
+/**
+ * @brief Append-only log of inverse operations , tagged with timestamps.
+ * Every change of an attached target (a tree , a record store ...)
+ * appends what is needed to undo it. Entries are buffered and written
+ * to the end of the file in large sequential writes.
+ *
+ * rollback(ts) reads entries newer than ts from the end backwards ,
+ * hands them to their targets in one batch each , and truncates the log.
+ * A target only needs the oldest entry of each item it changed , which
+ * tells the state of the item before ts , so it can sort the batch and
+ * restore each item once in its own order.
+ *
+ * Targets get their ids in the order they are attached. Attach them
+ * in the same order every time the log is opened.
+ *
+ * Layout: size_t end , then entries as
+ *      { long ts; int id; int length; } payload [length] int total;
+ * The total length at the end of an entry makes backward reads possible.
+ */
+class undo_log {
+  public:
+    /* A target whose changes can be undone. */
+    struct target {
+        virtual ~target() = default;
+        /**
+         * @brief Undo changes after some time.
+         * Payload i is at data + offset[i] , from newest to oldest.
+         */
+        virtual void undo(const char *data,const size_t *offset,size_t count) = 0;
+    };
+
+  private:
+    struct head {
+        long ts;     /* Time of the change. */
+        int  id;     /* Target of the change. */
+        int  length; /* Length of payload. */
+    };
+
+    using buffer_t = trivial_array <char,tagged_allocator <char,tag::undo_log>>;
+    using offset_t = trivial_array <size_t,tagged_allocator <size_t,tag::undo_log>>;
+
+    static constexpr size_t kHEAD  = sizeof(size_t);
+    static constexpr size_t kFLUSH = 1 << 16; /* Buffered bytes to flush. */
+    static constexpr size_t kCHUNK = 1 << 16; /* Least bytes read backwards. */
+
+    file_storage file;
+    size_t   end;  /* End of entries in the file. */
+    buffer_t buf;  /* Entries not written yet. */
+    long     time; /* Time of current changes. */
+    std::vector <target *> targets;
+
+    /* Write the end of entries to the file. */
+    void write_end() { file.write(&end,0,kHEAD); }
+
+  public:
+
+    /* Open the log at path. */
+    explicit undo_log(const std::string &path) : time(0) {
+        if(file.open(path)) file.read(&end,0,kHEAD);
+        else end = kHEAD,write_end();
+    }
+
+    undo_log(const undo_log &) = delete;
+
+    ~undo_log() { flush(); }
+
+
+    /* Attach a target. Return its id. */
+    int attach(target &__t) {
+        targets.push_back(&__t);
+        return targets.size() - 1;
+    }
+
+    /* Set the time of following changes , such as a command timestamp. */
+    void stamp(long ts) noexcept { time = ts; }
+
+    /* Time of current changes. */
+    long now() const noexcept { return time; }
+
+
+    /* Append an entry of target id , tagged with current time. */
+    void append(int id,const void *payload,size_t length) {
+        const head __h = { time,id,int(length) };
+        const int  total = sizeof(head) + length + sizeof(int);
+        size_t __n = buf.size();
+        buf.resize(__n + total);
+        char *__p = buf.data() + __n;
+        memcpy(__p,&__h,sizeof(head));
+        memcpy(__p + sizeof(head),payload,length);
+        memcpy(__p + total - sizeof(int),&total,sizeof(int));
+        if(buf.size() >= kFLUSH) flush();
+    }
+
+    /* Write buffered entries to the file. */
+    void flush() {
+        if(!buf.size()) return;
+        file.write(buf.data(),end,buf.size());
+        end += buf.size();
+        buf.clear();
+        write_end();
+    }
+
+
+    /**
+     * @brief Undo all changes tagged after ts , and drop their entries.
+     * The file is read backwards in growing chunks , and each target
+     * gets all its entries in one call.
+     *
+     * @return Count of entries undone.
+     */
+    size_t rollback(long ts) {
+        flush();
+        std::vector <buffer_t> data(targets.size());
+        std::vector <offset_t> offset(targets.size());
+
+        buffer_t window;    /* Bytes of [lo,end) in the file. */
+        size_t lo  = end;
+        size_t pos = end;   /* Start of the last entry read. */
+        size_t count = 0;
+
+        /* Make sure bytes from __x on are in the window. */
+        auto extend = [&](size_t __x) {
+            if(__x >= lo) return;
+            size_t __n = std::max(std::max(kCHUNK,end - lo),lo - __x);
+            size_t __l = lo - std::min(__n,lo - kHEAD);
+            buffer_t __w;
+            __w.resize(end - __l);
+            file.read(__w.data(),__l,lo - __l);
+            if(end != lo) memcpy(__w.data() + (lo - __l),window.data(),end - lo);
+            swap(window,__w);
+            lo = __l;
+        };
+
+        while(pos != kHEAD) {
+            int total;
+            extend(pos - sizeof(int));
+            memcpy(&total,window.data() + (pos - sizeof(int) - lo),sizeof(int));
+            extend(pos - total);
+            head __h;
+            const char *__p = window.data() + (pos - total - lo);
+            memcpy(&__h,__p,sizeof(head));
+            if(__h.ts <= ts) break;
+            pos -= total;
+            ++count;
+            if(size_t(__h.id) >= targets.size()) continue;
+            buffer_t &__d = data[__h.id];
+            offset[__h.id].push_back(__d.size());
+            __d.resize(__d.size() + __h.length);
+            memcpy(__d.data() + __d.size() - __h.length,__p + sizeof(head),__h.length);
+        }
+
+        for(size_t i = 0 ; i != targets.size() ; ++i)
+            if(offset[i].size())
+                targets[i]->undo(data[i].data(),offset[i].data(),offset[i].size());
+
+        end = pos;
+        write_end();
+        return count;
+    }
+};
+
+
+/**
+ * @brief A tree whose inserts and erases are logged.
+ * Only effective changes are logged , so the oldest entry of a pair
+ * after some time tells whether the pair existed then.
+ * Rollback restores each pair once , in order of key and value.
+ *
+ * @tparam tree_t Type of the tree.
+ */
+template <class tree_t,
+          class key_comp = Compare <typename tree_t::key_type>,
+          class val_comp = Compare <typename tree_t::mapped_type>>
+class logged_tree : public undo_log::target {
+  public:
+    using key_type    = typename tree_t::key_type;
+    using mapped_type = typename tree_t::mapped_type;
+    using return_list = typename tree_t::return_list;
+
+    static constexpr bool read_only = false;
+
+  private:
+    struct item {
+        key_type    key;
+        mapped_type val;
+        bool inserted; /* Whether the change was an insert. */
+    };
+    static_assert(std::is_trivially_copyable_v <item>,"Key and value must be trivially copyable!");
+
+    tree_t   &t;
+    undo_log &log;
+    const int id;
+
+  public:
+
+    logged_tree(tree_t &__t,undo_log &__l) : t(__t),log(__l),id(__l.attach(*this)) {}
+
+    logged_tree(const logged_tree &) = delete;
+
+
+    /* Insert a pair , logged if it is new. */
+    void insert(const key_type &key,const mapped_type &val) {
+        if(t.contains(key,val)) return;
+        const item __x = { key,val,true };
+        log.append(id,&__x,sizeof(item));
+        t.insert(key,val);
+    }
+
+    /* Erase a pair , logged if it exists. */
+    void erase(const key_type &key,const mapped_type &val) {
+        if(!t.contains(key,val)) return;
+        const item __x = { key,val,false };
+        log.append(id,&__x,sizeof(item));
+        t.erase(key,val);
+    }
+
+    void find(const key_type &key,return_list &v) { t.find(key,v); }
+
+    /* The tree logged. */
+    tree_t &base() noexcept { return t; }
+
+
+    void undo(const char *data,const size_t *offset,size_t count) override {
+        trivial_array <item> items;
+        items.resize(count);
+        for(size_t i = 0 ; i != count ; ++i)
+            memcpy(&items[i],data + offset[i],sizeof(item));
+
+        /* Stable , so entries of a pair stay newest first. */
+        auto cmp = [](const item &x,const item &y) {
+            int __c = key_comp()(x.key,y.key);
+            return __c ? __c < 0 : val_comp()(x.val,y.val) < 0;
+        };
+        std::stable_sort(items.data(),items.data() + count,cmp);
+
+        for(size_t i = 0,j ; i != count ; i = j) {
+            for(j = i + 1 ; j != count && !cmp(items[i],items[j]) ; ++j);
+            const item &__x = items[j - 1]; /* Oldest. */
+            if(__x.inserted) t.erase (__x.key,__x.val);
+            else             t.insert(__x.key,__x.val);
+        }
+    }
+};
+
+
+/**
+ * @brief Fixed-size records whose updates are logged.
+ * The store reads and writes records by position through
+ * get(pos,T &) and set(pos,const T &) , such as order_log.
+ * The old image of a record is logged when it really changes.
+ * Rollback writes back the oldest image of each record once ,
+ * in order of position.
+ *
+ * @tparam store_t Type of the store.
+ * @tparam T       Trivially copyable record type.
+ * @tparam pos_t   Position of a record.
+ */
+template <class store_t,class T,class pos_t = size_t>
+class logged_records : public undo_log::target {
+  private:
+    struct item {
+        pos_t pos;
+        T     old; /* Image before the change. */
+    };
+    static_assert(std::is_trivially_copyable_v <item>,"Record must be trivially copyable!");
+
+    store_t  &s;
+    undo_log &log;
+    const int id;
+
+  public:
+
+    logged_records(store_t &__s,undo_log &__l) : s(__s),log(__l),id(__l.attach(*this)) {}
+
+    logged_records(const logged_records &) = delete;
+
+
+    void get(pos_t __p,T &x) { s.get(__p,x); }
+
+    /* Overwrite a record , logging its old image. */
+    void set(pos_t __p,const T &x) {
+        item __x;
+        __x.pos = __p;
+        s.get(__p,__x.old);
+        if(!memcmp(&__x.old,&x,sizeof(T))) return;
+        log.append(id,&__x,sizeof(item));
+        s.set(__p,x);
+    }
+
+    /* Update a record by func(T &) , logging its old image. */
+    template <class func_t>
+    void modify(pos_t __p,func_t &&func) {
+        T x;
+        s.get(__p,x);
+        func(x);
+        set(__p,x);
+    }
+
+    /* The store logged. */
+    store_t &base() noexcept { return s; }
+
+
+    void undo(const char *data,const size_t *offset,size_t count) override {
+        trivial_array <item> items;
+        items.resize(count);
+        for(size_t i = 0 ; i != count ; ++i)
+            memcpy(&items[i],data + offset[i],sizeof(item));
+
+        /* Stable , so images of a record stay newest first. */
+        auto cmp = [](const item &x,const item &y) { return x.pos < y.pos; };
+        std::stable_sort(items.data(),items.data() + count,cmp);
+
+        for(size_t i = 0,j ; i != count ; i = j) {
+            for(j = i + 1 ; j != count && items[j].pos == items[i].pos ; ++j);
+            s.set(items[j - 1].pos,items[j - 1].old);
+        }
+    }
+};
+
+
+}
+
+#endif
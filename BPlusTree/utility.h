@@ -1,9 +1,11 @@
 #ifndef _DARK_BPLUS_UTILITY_H_
 #define _DARK_BPLUS_UTILITY_H_
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include "Dark/inout"
+#include "Dark/alloc_profile"
 
 namespace dark {
 
@@ -23,12 +25,17 @@ struct error {
 struct file_state {
     int  index; /* Index of the real data. */
     bool state; /* Use highest bit to store modification state. */
+    uint64_t dirty; /* Dirty sectors if partly modified. 0 if whole. */
 
     /* Return whether the file is modified. */
     bool is_modified() const noexcept { return state; }
     /* Modify the file_state. */
-    void modify() noexcept { state = true; }
-    
+    void modify() noexcept { state = true; dirty = 0; }
+    /* Modify sectors in mask only. A wholly modified file stays whole. */
+    void modify(uint64_t mask) noexcept {
+        if(!state) state = true,dirty = mask;
+        else if(dirty) dirty |= mask;
+    }
 };
 
 
@@ -69,6 +76,19 @@ struct Compare_Int {
     const noexcept { return lhs - rhs; }
 };
 
+
+/* Allocation profile tags of subsystems. See Dark/alloc_profile. */
+namespace tag {
+struct buffer_pool  { static constexpr const char *name = "buffer_pool"; };
+struct hash_table   { static constexpr const char *name = "hash_table";  };
+struct free_list    { static constexpr const char *name = "free_list";   };
+struct result_list  { static constexpr const char *name = "result_list"; };
+struct parser       { static constexpr const char *name = "parser";      };
+struct trace        { static constexpr const char *name = "trace";       };
+struct result_cache { static constexpr const char *name = "result_cache"; };
+struct undo_log     { static constexpr const char *name = "undo_log";     };
+}
+
 }
 
 
@@ -0,0 +1,175 @@
+#ifndef _DARK_WAITLIST_H_
+#define _DARK_WAITLIST_H_
+
+#include "file_manager.h"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace dark {
+
+/**
+ * @brief Persistent FIFO queues of fixed-size entries , in chained pages.
+ * Many queues share one file. A queue is a chain of pages from head
+ * to tail , and the caller keeps its handle , such as in the record
+ * of (train,date). Append writes only the tail page. Entries removed
+ * during a scan are tombstoned in place , and pages left without live
+ * entries are unlinked and recycled through the rubbish bin.
+ *
+ * @tparam T Trivially copyable entry type.
+ */
+template <class T>
+class waitlist {
+  public:
+    /* Handle of one queue. Keep it with the owner of the queue. */
+    struct handle {
+        int    head = -1; /* First page , -1 if empty. */
+        int    tail = -1; /* Last page , -1 if empty. */
+        size_t size =  0; /* Count of live entries. */
+
+        bool empty() const noexcept { return !size; }
+    };
+
+    /* Returned by a scan callback , and can be combined. */
+    enum action : int {
+        keep  = 0, /* Keep the entry and go on. */
+        erase = 1, /* Remove the entry. */
+        stop  = 2  /* Stop after this entry. */
+    };
+
+  private:
+    static_assert(std::is_trivially_copyable_v <T>,"Entry must be trivially copyable!");
+
+    static constexpr size_t kPAGE  = 4096;
+    static constexpr int    kWORDS = (kPAGE / sizeof(T) + 63) / 64;
+    /* Entries per page. */
+    static constexpr int    kCAP   = (kPAGE - 16 - 8 * kWORDS) / sizeof(T);
+    static_assert(kCAP > 0,"Entry too large!");
+
+    struct page {
+        int next;  /* Next page , -1 if last. */
+        int count; /* Entries appended. */
+        int live;  /* Entries not removed. */
+        uint64_t alive[kWORDS]; /* Bit i : entry i is not removed. */
+        T data[kCAP];
+    };
+
+    cached_file_manager <page,1031,256,kPAGE> pages;
+
+    /* Byte offset of a member of page. */
+    template <class U>
+    static size_t offset(const page &__p,const U &__m) noexcept
+    { return (const char *)&__m - (const char *)&__p; }
+
+    /* Mark the header of a page modified. */
+    static void touch(typename decltype(pages)::visitor pointer)
+    { pointer.modify_range(0,offset(*pointer,pointer->alive)); }
+
+    /* Start a new empty page after the tail. */
+    void grow(handle &__h) {
+        auto pointer = pages.allocate();
+        pointer->next  = -1;
+        pointer->count = 0;
+        pointer->live  = 0;
+        memset(pointer->alive,0,sizeof(pointer->alive));
+        int index = pointer.index();
+        if(__h.tail == -1) __h.head = index;
+        else {
+            auto last = pages.get_object(__h.tail);
+            last->next = index;
+            touch(last);
+        } __h.tail = index;
+    }
+
+  public:
+
+    /* Open the waitlist with files at path. */
+    explicit waitlist(const std::string &path) :
+        pages(path + ".wait",path + ".wait.bin") {}
+
+    waitlist(const waitlist &) = delete;
+
+
+    /* Append an entry to the back of a queue. */
+    void push(handle &__h,const T &x) {
+        if(__h.tail == -1 || pages.get_object(__h.tail)->count == kCAP) grow(__h);
+        auto pointer = pages.get_object(__h.tail);
+        int i = pointer->count++;
+        ++pointer->live;
+        pointer->data[i] = x;
+        pointer->alive[i / 64] |= 1ull << (i % 64);
+        touch(pointer);
+        pointer.modify_range(offset(*pointer,pointer->alive[i / 64]),sizeof(uint64_t));
+        pointer.modify_range(offset(*pointer,pointer->data[i]),sizeof(T));
+        ++__h.size;
+    }
+
+
+    /**
+     * @brief Visit live entries of a queue from front to back.
+     * func(T &) returns an action. Entries may be modified in place.
+     * Pages emptied by the scan are recycled.
+     */
+    template <class func_t>
+    void scan(handle &__h,func_t &&func) {
+        int prev = -1;
+        for(int index = __h.head ; index != -1 ;) {
+            auto pointer = pages.get_object(index);
+            int flag = keep;
+            for(int i = 0 ; i != pointer->count && !(flag & stop) ; ++i) {
+                if(!(pointer->alive[i / 64] >> (i % 64) & 1)) continue;
+                T __x = pointer->data[i];
+                flag = func(pointer->data[i]);
+                if(flag & erase) {
+                    pointer->alive[i / 64] &= ~(1ull << (i % 64));
+                    --pointer->live;
+                    --__h.size;
+                    touch(pointer);
+                    pointer.modify_range(offset(*pointer,pointer->alive[i / 64]),sizeof(uint64_t));
+                } else if(memcmp(&__x,&pointer->data[i],sizeof(T))) /* Modified in place. */
+                    pointer.modify_range(offset(*pointer,pointer->data[i]),sizeof(T));
+            }
+
+            int next = pointer->next;
+            if(!pointer->live && index != __h.tail) { /* Unlink an empty page. */
+                if(prev == -1) __h.head = next;
+                else {
+                    auto before = pages.get_object(prev);
+                    before->next = next;
+                    touch(before);
+                }
+                pages.recycle(index);
+            } else prev = index;
+            if(flag & stop) break;
+            index = next;
+        }
+        if(!__h.size) clear(__h);
+    }
+
+
+    /* Visit live entries of a queue from front to back , read-only. */
+    template <class func_t>
+    void for_each(const handle &__h,func_t &&func) {
+        for(int index = __h.head ; index != -1 ;) {
+            auto pointer = pages.get_object(index);
+            for(int i = 0 ; i != pointer->count ; ++i)
+                if(pointer->alive[i / 64] >> (i % 64) & 1) func(pointer->data[i]);
+            index = pointer->next;
+        }
+    }
+
+
+    /* Remove all entries of a queue , recycling its pages. */
+    void clear(handle &__h) {
+        for(int index = __h.head ; index != -1 ;) {
+            int next = pages.get_object(index)->next;
+            pages.recycle(index);
+            index = next;
+        } __h = handle {};
+    }
+};
+
+
+}
+
+#endif
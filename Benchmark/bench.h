@@ -0,0 +1,104 @@
+#ifndef _DARK_BENCH_H_
+#define _DARK_BENCH_H_
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+namespace dark {
+
+namespace bench {
+
+/* Keep the optimizer from discarding the object behind the pointer. */
+inline void escape(const void *__p) { asm volatile("" : : "g"(__p) : "memory"); }
+
+/* Keep the optimizer from discarding a computed value. */
+template <class T>
+inline void keep(const T &__v) { escape(&__v); }
+
+
+/**
+ * @brief Trivial element of a given size for element size sweeps.
+ * The key is stored in the first 8 bytes, the rest is padding.
+ *
+ * @tparam N Size of the element in bytes (N > 8).
+ */
+template <size_t N>
+struct payload {
+    static_assert(N > sizeof(size_t),"Too small,payload size!");
+    size_t key;
+    char   pad[N - sizeof(size_t)];
+
+    payload() noexcept = default;
+    payload(size_t __k) noexcept : key(__k) {}
+
+    friend bool operator < (const payload &lhs,const payload &rhs)
+    noexcept { return lhs.key < rhs.key; }
+    friend bool operator > (const payload &lhs,const payload &rhs)
+    noexcept { return lhs.key > rhs.key; }
+};
+
+
+/* Deterministic xorshift generator, so that every run sees the same keys. */
+struct xorshift {
+    uint64_t state;
+    xorshift(uint64_t __s = 0x9E3779B97F4A7C15ull) noexcept : state(__s) {}
+    uint64_t operator ()() noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+
+/**
+ * @brief Time a piece of work with a fresh setup per round.
+ *
+ * @param setup Called before every round, excluded from timing.
+ * @param body  The work to time.
+ * @param ops   Count of operations done by one call of body.
+ * @param round Count of rounds. The fastest round is taken.
+ * @return Nanoseconds per operation of the fastest round.
+ */
+template <class Setup,class Body>
+double measure(Setup &&setup,Body &&body,size_t ops,int round) {
+    using clock = std::chrono::steady_clock;
+    double best = 1e300;
+    while(round--) {
+        setup();
+        auto start = clock::now();
+        body();
+        auto finish = clock::now();
+        double ns = std::chrono::duration <double,std::nano> (finish - start).count();
+        if(ns < best) best = ns;
+    }
+    return ops ? best / ops : best;
+}
+
+
+/* CSV writer of benchmark results. */
+struct reporter {
+    FILE *out;
+
+    reporter(FILE *__f = stdout) noexcept : out(__f) {
+        fputs("group,container,operation,element_bytes,count,ns_per_op\n",out);
+    }
+
+    /* Write one line of result. */
+    void row(const char *group,const char *container,const char *operation,
+             size_t bytes,size_t count,double ns) {
+        fprintf(out,"%s,%s,%s,%zu,%zu,%.3f\n",
+                group,container,operation,bytes,count,ns);
+        fflush(out);
+    }
+};
+
+
+}
+
+}
+
+#endif
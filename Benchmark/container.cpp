@@ -0,0 +1,478 @@
+#include "bench.h"
+#include "Dark/trivial_array"
+#include "Dark/dynamic_array"
+#include "Dark/LRU_map"
+#include "Dark/map"
+#include "Dark/Container/heap.h"
+
+#include <map>
+#include <queue>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * Microbenchmark of Dark containers against their std equivalents.
+ * Usage: container_bench [count] [round] > result.csv
+ *
+ * list_array and round_array are left out, for the former is abandoned
+ * and the latter is not finished yet.
+ */
+
+namespace {
+
+using dark::bench::keep;
+using dark::bench::measure;
+using dark::bench::payload;
+using dark::bench::reporter;
+using dark::bench::xorshift;
+
+constexpr size_t kTABLESIZE = 1000003; /* Table size of linked hash containers. */
+
+size_t count = 1 << 18; /* Elements per operation. */
+int    rounds = 5;      /* Rounds per operation. */
+
+/* Random keys, identical for every container. */
+std::vector <size_t> keys;
+/* Random keys that are never inserted. */
+std::vector <size_t> miss;
+/* Random indexes in [0,count). */
+std::vector <size_t> order;
+/* Random choices for mixed workloads. */
+std::vector <unsigned> choice;
+
+void init_keys() {
+    xorshift rng;
+    keys.resize(count);
+    miss.resize(count);
+    order.resize(count);
+    choice.resize(count);
+    /* Odd keys are inserted , even keys are missed. */
+    for(auto &iter : keys)   iter = rng() | 1;
+    for(auto &iter : miss)   iter = rng() & ~size_t(1);
+    for(auto &iter : order)  iter = rng() % count;
+    for(auto &iter : choice) iter = rng() % 4;
+}
+
+
+/* Array-like containers: dark::trivial_array / dark::dynamic_array / std::vector. */
+template <class array_t,size_t N>
+void bench_array(reporter &out,const char *name) {
+    using value_t = payload <N>;
+    array_t a;
+    const char *group = "array";
+
+    out.row(group,name,"push_back",N,count,measure(
+        [&]() { a.clear(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) a.push_back(value_t(keys[i])); },
+        count,rounds
+    ));
+
+    out.row(group,name,"iterate",N,count,measure(
+        [&]() {},
+        [&]() { size_t sum = 0; for(auto &iter : a) sum += iter.key; keep(sum); },
+        count,rounds
+    ));
+
+    out.row(group,name,"lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) sum += a[order[i]].key;
+            keep(sum);
+        },
+        count,rounds
+    ));
+
+    out.row(group,name,"pop_back",N,count,measure(
+        [&]() { a.clear(); for(size_t i = 0 ; i != count ; ++i) a.push_back(value_t(keys[i])); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) a.pop_back(); keep(a); },
+        count,rounds
+    ));
+
+    out.row(group,name,"mixed",N,count,measure(
+        [&]() { a.clear(); },
+        [&]() {
+            for(size_t i = 0 ; i != count ; ++i) {
+                if(choice[i] == 0 && a.size()) a.pop_back();
+                else a.push_back(value_t(keys[i]));
+            } keep(a);
+        },
+        count,rounds
+    ));
+}
+
+
+/* Hash maps: dark::linked_hash_map / std::unordered_map. */
+template <size_t N>
+void bench_hash_map(reporter &out) {
+    using value_t = payload <N>;
+    using dark_t  = dark::linked_hash_map <size_t,value_t,kTABLESIZE>;
+    using std_t   = std::unordered_map <size_t,value_t>;
+    const char *group = "hash_map";
+
+    /* The table is too large to live on stack. */
+    std::unique_ptr <dark_t> d;
+    std_t s;
+    auto fill_d = [&]() {
+        d.reset(new dark_t);
+        for(size_t i = 0 ; i != count ; ++i) d->insert(keys[i],value_t(keys[i]));
+    };
+    auto fill_s = [&]() {
+        s = std_t();
+        for(size_t i = 0 ; i != count ; ++i) s.emplace(keys[i],value_t(keys[i]));
+    };
+
+    out.row(group,"dark::linked_hash_map","insert",N,count,measure(
+        [&]() { d.reset(new dark_t); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d->insert(keys[i],value_t(keys[i])); },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_map","insert",N,count,measure(
+        [&]() { s = std_t(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.emplace(keys[i],value_t(keys[i])); },
+        count,rounds
+    ));
+
+    fill_d(); fill_s();
+    out.row(group,"dark::linked_hash_map","lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i)
+                sum += d->find_pre(keys[order[i]]).next_data()->second.key;
+            keep(sum);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_map","lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i)
+                sum += s.find(keys[order[i]])->second.key;
+            keep(sum);
+        },
+        count,rounds
+    ));
+
+    out.row(group,"dark::linked_hash_map","lookup_miss",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i)
+                sum += d->find_pre(miss[i]).next_data() != nullptr;
+            keep(sum);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_map","lookup_miss",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) sum += s.count(miss[i]);
+            keep(sum);
+        },
+        count,rounds
+    ));
+
+    out.row(group,"dark::linked_hash_map","iterate",N,count,measure(
+        [&]() {},
+        [&]() { size_t sum = 0; for(auto &&iter : *d) sum += iter.second.key; keep(sum); },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_map","iterate",N,count,measure(
+        [&]() {},
+        [&]() { size_t sum = 0; for(auto &&iter : s) sum += iter.second.key; keep(sum); },
+        count,rounds
+    ));
+
+    out.row(group,"dark::linked_hash_map","erase",N,count,measure(
+        fill_d,
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d->erase(keys[i]); },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_map","erase",N,count,measure(
+        fill_s,
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.erase(keys[i]); },
+        count,rounds
+    ));
+
+    /* Half lookup , a quarter insert and a quarter erase over half the keys. */
+    out.row(group,"dark::linked_hash_map","mixed",N,count,measure(
+        [&]() { d.reset(new dark_t); },
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) {
+                size_t key = keys[order[i] >> 1];
+                auto  *__p = d->find_pre(key).next_data();
+                if(choice[i] < 2) sum += __p != nullptr;
+                else if(choice[i] == 2) { if(!__p) d->insert(key,value_t(key)); }
+                else if(__p) d->erase(key);
+            } keep(sum);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_map","mixed",N,count,measure(
+        [&]() { s = std_t(); },
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) {
+                size_t key = keys[order[i] >> 1];
+                if(choice[i] < 2) sum += s.count(key);
+                else if(choice[i] == 2) s.emplace(key,value_t(key));
+                else s.erase(key);
+            } keep(sum);
+        },
+        count,rounds
+    ));
+}
+
+
+/**
+ * Hash sets: dark::linked_hash_set / std::unordered_set.
+ * Keys are 32-bit, for linked_hash_set can't tell a size_t key
+ * from a hash code.
+ */
+void bench_hash_set(reporter &out) {
+    using dark_t = dark::linked_hash_set <unsigned,kTABLESIZE>;
+    using std_t  = std::unordered_set <unsigned>;
+    const char *group = "hash_set";
+    const size_t N    = sizeof(unsigned);
+
+    std::vector <unsigned> key32(keys.begin(),keys.end());
+    std::unique_ptr <dark_t> d;
+    std_t s;
+
+    out.row(group,"dark::linked_hash_set","insert",N,count,measure(
+        [&]() { d.reset(new dark_t); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d->insert(key32[i]); },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_set","insert",N,count,measure(
+        [&]() { s = std_t(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.insert(key32[i]); },
+        count,rounds
+    ));
+
+    out.row(group,"dark::linked_hash_set","lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) sum += d->exist(key32[order[i]]);
+            keep(sum);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_set","lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) sum += s.count(key32[order[i]]);
+            keep(sum);
+        },
+        count,rounds
+    ));
+
+    out.row(group,"dark::linked_hash_set","erase",N,count,measure(
+        [&]() { d.reset(new dark_t); for(size_t i = 0 ; i != count ; ++i) d->insert(key32[i]); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d->erase(key32[i]); },
+        count,rounds
+    ));
+    out.row(group,"std::unordered_set","erase",N,count,measure(
+        [&]() { s = std_t(); for(size_t i = 0 ; i != count ; ++i) s.insert(key32[i]); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.erase(key32[i]); },
+        count,rounds
+    ));
+}
+
+
+/* Ordered maps: dark::map / std::map. */
+template <size_t N>
+void bench_map(reporter &out) {
+    using value_t = payload <N>;
+    using dark_t  = dark::map <size_t,value_t>;
+    using std_t   = std::map  <size_t,value_t>;
+    const char *group = "map";
+
+    dark_t d;
+    std_t  s;
+    auto fill_d = [&]() {
+        d.clear();
+        for(size_t i = 0 ; i != count ; ++i) d.insert({keys[i],value_t(keys[i])});
+    };
+    auto fill_s = [&]() {
+        s.clear();
+        for(size_t i = 0 ; i != count ; ++i) s.insert({keys[i],value_t(keys[i])});
+    };
+
+    out.row(group,"dark::map","insert",N,count,measure(
+        [&]() { d.clear(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d.insert({keys[i],value_t(keys[i])}); },
+        count,rounds
+    ));
+    out.row(group,"std::map","insert",N,count,measure(
+        [&]() { s.clear(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.insert({keys[i],value_t(keys[i])}); },
+        count,rounds
+    ));
+
+    fill_d(); fill_s();
+    out.row(group,"dark::map","lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) sum += d.find(keys[order[i]])->second.key;
+            keep(sum);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::map","lookup",N,count,measure(
+        [&]() {},
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) sum += s.find(keys[order[i]])->second.key;
+            keep(sum);
+        },
+        count,rounds
+    ));
+
+    out.row(group,"dark::map","iterate",N,count,measure(
+        [&]() {},
+        [&]() { size_t sum = 0; for(auto &&iter : d) sum += iter.second.key; keep(sum); },
+        count,rounds
+    ));
+    out.row(group,"std::map","iterate",N,count,measure(
+        [&]() {},
+        [&]() { size_t sum = 0; for(auto &&iter : s) sum += iter.second.key; keep(sum); },
+        count,rounds
+    ));
+
+    out.row(group,"dark::map","erase",N,count,measure(
+        fill_d,
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d.erase(keys[i]); },
+        count,rounds
+    ));
+    out.row(group,"std::map","erase",N,count,measure(
+        fill_s,
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.erase(keys[i]); },
+        count,rounds
+    ));
+
+    out.row(group,"dark::map","mixed",N,count,measure(
+        [&]() { d.clear(); },
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) {
+                size_t key = keys[order[i] >> 1];
+                if(choice[i] < 2) sum += d.count(key);
+                else if(choice[i] == 2) d.insert({key,value_t(key)});
+                else d.erase(key);
+            } keep(sum);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::map","mixed",N,count,measure(
+        [&]() { s.clear(); },
+        [&]() {
+            size_t sum = 0;
+            for(size_t i = 0 ; i != count ; ++i) {
+                size_t key = keys[order[i] >> 1];
+                if(choice[i] < 2) sum += s.count(key);
+                else if(choice[i] == 2) s.insert({key,value_t(key)});
+                else s.erase(key);
+            } keep(sum);
+        },
+        count,rounds
+    ));
+}
+
+
+/* Priority queues: dark::heap / std::priority_queue , both min-heap. */
+template <size_t N>
+void bench_heap(reporter &out) {
+    using value_t = payload <N>;
+    using dark_t  = dark::heap <value_t,std::less <value_t>>;
+    using std_t   = std::priority_queue <value_t,std::vector <value_t>,std::greater <value_t>>;
+    const char *group = "heap";
+
+    dark_t d;
+    std_t  s;
+
+    out.row(group,"dark::heap","push",N,count,measure(
+        [&]() { d.clear(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) d.push(value_t(keys[i])); },
+        count,rounds
+    ));
+    out.row(group,"std::priority_queue","push",N,count,measure(
+        [&]() { s = std_t(); },
+        [&]() { for(size_t i = 0 ; i != count ; ++i) s.push(value_t(keys[i])); },
+        count,rounds
+    ));
+
+    out.row(group,"dark::heap","pop",N,count,measure(
+        [&]() { d.clear(); for(size_t i = 0 ; i != count ; ++i) d.push(value_t(keys[i])); },
+        [&]() { size_t sum = 0; while(!d.empty()) sum += d.top().key,d.pop(); keep(sum); },
+        count,rounds
+    ));
+    out.row(group,"std::priority_queue","pop",N,count,measure(
+        [&]() { s = std_t(); for(size_t i = 0 ; i != count ; ++i) s.push(value_t(keys[i])); },
+        [&]() { size_t sum = 0; while(!s.empty()) sum += s.top().key,s.pop(); keep(sum); },
+        count,rounds
+    ));
+
+    out.row(group,"dark::heap","mixed",N,count,measure(
+        [&]() { d.clear(); },
+        [&]() {
+            for(size_t i = 0 ; i != count ; ++i) {
+                if(choice[i] == 0 && !d.empty()) d.pop();
+                else d.push(value_t(keys[i]));
+            } keep(d);
+        },
+        count,rounds
+    ));
+    out.row(group,"std::priority_queue","mixed",N,count,measure(
+        [&]() { s = std_t(); },
+        [&]() {
+            for(size_t i = 0 ; i != count ; ++i) {
+                if(choice[i] == 0 && !s.empty()) s.pop();
+                else s.push(value_t(keys[i]));
+            } keep(s);
+        },
+        count,rounds
+    ));
+}
+
+
+/* Run all groups at given element size. */
+template <size_t N>
+void bench_all(reporter &out) {
+    bench_array <dark::trivial_array <payload <N>>,N> (out,"dark::trivial_array");
+    bench_array <dark::dynamic_array <payload <N>>,N> (out,"dark::dynamic_array");
+    bench_array <std::vector         <payload <N>>,N> (out,"std::vector");
+    bench_hash_map <N> (out);
+    bench_map      <N> (out);
+    bench_heap     <N> (out);
+}
+
+}
+
+
+signed main(int argc,char **argv) {
+    if(argc > 1) count = strtoull(argv[1],nullptr,10);
+    if(argc > 2) rounds = atoi(argv[2]);
+    if(!count || rounds <= 0) {
+        fprintf(stderr,"Usage: %s [count] [round]\n",argv[0]);
+        return 1;
+    }
+
+    init_keys();
+    reporter out;
+    bench_hash_set(out);
+    bench_all <16>  (out);
+    bench_all <64>  (out);
+    bench_all <256> (out);
+    return 0;
+}
@@ -20,7 +20,8 @@ template <
     class   T,
     size_t kTABLESIZE,
     class Hash    = std::hash <key_t>,
-    class Compare = std::equal_to <key_t>
+    class Compare = std::equal_to <key_t>,
+    class Alloc   = std::allocator <std::pair <key_t,T>>
 > 
 class linked_hash_map {
   public:
@@ -35,7 +36,8 @@ class linked_hash_map {
     using listptr   = list::baseptr;
     using node      = hash::linked_node <value_t>;
     using pointer   = hash::linked_node <value_t> *;
-    using Implement = implement <node,std::allocator <node>,Compare,Hash>;
+    using node_alloc = typename std::allocator_traits <Alloc>::template rebind_alloc <node>;
+    using Implement  = implement <node,node_alloc,Compare,Hash>;
 
   private:
 
@@ -201,7 +203,8 @@ template <
     class key_t,
     size_t kTABLESIZE,
     class Hash    = std::hash <key_t>,
-    class Compare = std::equal_to <key_t>
+    class Compare = std::equal_to <key_t>,
+    class Alloc   = std::allocator <key_t>
 > 
 class linked_hash_set {
   public:
@@ -215,7 +218,8 @@ class linked_hash_set {
     using listptr   = list::baseptr;
     using node      = hash::linked_node <key_t>;
     using pointer   = hash::linked_node <key_t> *;
-    using Implement = implement <node,std::allocator <node>,Compare,Hash>;
+    using node_alloc = typename std::allocator_traits <Alloc>::template rebind_alloc <node>;
+    using Implement  = implement <node,node_alloc,Compare,Hash>;
 
   private:
 
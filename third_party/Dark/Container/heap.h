@@ -15,16 +15,16 @@ class heap {
   private:
 
     struct node;
-    using implement = implement <node,std::allocator <node>,Compare>;
+    using Implement = implement <node,std::allocator <node>,Compare>;
     using pointer = node *;
 
   private:
 
     pointer   root;  /* Root node of the tree. */
-    implement impl;  /* Allocator and compare function. */
+    Implement impl;  /* Allocator and compare function. */
 
     /* Merge 2 nodes x and y. */
-    static pointer merge(pointer x,pointer y) {
+    pointer merge(pointer x,pointer y) {
         if(!x) return y;
         if(!y) return x;
         /* Now x and y are not empty. */
@@ -37,7 +37,7 @@ class heap {
     /* Copy node info from cur node. */
     pointer copy(pointer cur) {
         if(!cur) return nullptr;
-        return alloc(copy(cur->ls),copy(cur->rs),cur->dist,cur->val);
+        return impl.alloc(copy(cur->ls),copy(cur->rs),cur->val);
     }
 
     /* Remove current node with its sub-tree */
@@ -45,7 +45,7 @@ class heap {
         if(!cur) return;
         remove(cur->ls);
         remove(cur->rs);
-        this->dealloc(cur);
+        impl.dealloc(cur);
     }
 
   public:
@@ -54,7 +54,8 @@ class heap {
     heap() noexcept : root(nullptr) {}
 
     /* Copy content. */
-    heap(const heap &rhs) : root(copy(rhs.root)),impl(rhs.impl) {}
+    heap(const heap &rhs) : root(nullptr),impl(rhs.impl)
+    { root = copy(rhs.root); impl.count = rhs.impl.count; }
 
     /* Move content. */
     heap(heap &&rhs) noexcept
@@ -126,7 +127,7 @@ class heap {
         value_t val;
 
         template <class ...Args>
-        node(pointer _l,pointer _r,size_t _d,Args &&...objs):
+        node(pointer _l,pointer _r,Args &&...objs):
             ls(_l),rs(_r),val(std::forward <Args> (objs)...) {}
 
         ~node() = default;
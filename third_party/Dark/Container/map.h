@@ -31,11 +31,11 @@ class map {
     using baseptr   = tree::node_base *;
     using node      = tree::node <value_t>;
     using pointer   = tree::node <value_t> *;
-    using implement = implement <node,std::allocator <node>,Compare>;
+    using Implement = implement <node,std::allocator <node>,Compare>;
 
   private:
 
-    implement impl;   /* Implement of compare and memory function. */
+    Implement impl;   /* Implement of compare and memory function. */
     node_base header; /* Parent as root node || son[0] as largest || son[1] as smallest. */
 
     /* Return the root node of the tree. */
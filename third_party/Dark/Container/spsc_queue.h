@@ -0,0 +1,85 @@
+#ifndef _DARK_SPSC_QUEUE_H_
+#define _DARK_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <thread>
+#include <cstddef>
+
+namespace dark {
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer
+ * thread and one consumer thread.
+ * Each side keeps a cached copy of the other side's index,
+ * so the shared indexes are only read when the cache runs out.
+ *
+ * @tparam value_t A trivially copyable type , such as a pointer.
+ * @tparam kSIZE   Capacity. Must be a power of 2.
+ */
+template <class value_t,size_t kSIZE>
+class spsc_queue {
+  private:
+    static_assert(kSIZE && !(kSIZE & (kSIZE - 1)),"Size should be power of 2!");
+    static constexpr size_t kLINE = 64; /* Cache line size. */
+
+    alignas(kLINE) std::atomic <size_t> head; /* Next to pop. Written by consumer. */
+    alignas(kLINE) size_t tail_cache;         /* Consumer's view of tail. */
+    alignas(kLINE) std::atomic <size_t> tail; /* Next to push. Written by producer. */
+    alignas(kLINE) size_t head_cache;         /* Producer's view of head. */
+    alignas(kLINE) value_t data[kSIZE];
+
+  public:
+
+    spsc_queue() noexcept : head(0),tail_cache(0),tail(0),head_cache(0) {}
+    spsc_queue(const spsc_queue &) = delete;
+
+    /* Try to push one element. Return false if full. Producer only. */
+    bool try_push(const value_t &obj) noexcept {
+        size_t __t = tail.load(std::memory_order_relaxed);
+        if(__t - head_cache == kSIZE) {
+            head_cache = head.load(std::memory_order_acquire);
+            if(__t - head_cache == kSIZE) return false;
+        }
+        data[__t & (kSIZE - 1)] = obj;
+        tail.store(__t + 1,std::memory_order_release);
+        return true;
+    }
+
+    /* Try to pop one element. Return false if empty. Consumer only. */
+    bool try_pop(value_t &obj) noexcept {
+        size_t __h = head.load(std::memory_order_relaxed);
+        if(__h == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if(__h == tail_cache) return false;
+        }
+        obj = data[__h & (kSIZE - 1)];
+        head.store(__h + 1,std::memory_order_release);
+        return true;
+    }
+
+    /* Push one element , yielding while full. Producer only. */
+    void push(const value_t &obj) noexcept
+    { while(!try_push(obj)) std::this_thread::yield(); }
+
+    /* Pop one element , yielding while empty. Consumer only. */
+    value_t pop() noexcept {
+        value_t obj;
+        while(!try_pop(obj)) std::this_thread::yield();
+        return obj;
+    }
+
+    /* Count of elements. Exact only when both sides are idle. */
+    size_t size() const noexcept {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /* Whether empty. Exact only when both sides are idle. */
+    bool empty() const noexcept { return !size(); }
+
+    /* Capacity of the queue. */
+    static constexpr size_t capacity() noexcept { return kSIZE; }
+};
+
+}
+
+#endif
@@ -14,9 +14,10 @@ namespace dark {
  * utilizing memcpy and memset to speed up greatly.
  * 
  * @tparam value_t A trivial type.
+ * @tparam allocator_t Allocator of the storage.
  */
-template <class value_t>
-class trivial_array : private std::allocator <value_t>  {
+template <class value_t,class allocator_t = std::allocator <value_t>>
+class trivial_array : private allocator_t  {
   private:
     value_t *head; /* Head pointer to first element. */
     value_t *tail; /* Tail pointer to one past the last element. */
@@ -0,0 +1,147 @@
+#ifndef _DARK_ALLOC_PROFILE_H_
+#define _DARK_ALLOC_PROFILE_H_
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstdio>
+
+namespace dark {
+
+/**
+ * @brief Allocation profiler with per-subsystem tags.
+ * A tag is an empty class with a static name , for example:
+ *
+ *     struct parser_tag { static constexpr const char *name = "parser"; };
+ *
+ * Containers allocating through tagged_allocator <T,parser_tag>
+ * are accounted to that tag. Counting is only compiled in when
+ * DARK_ALLOC_PROFILE is defined. Otherwise , tagged_allocator is
+ * exactly std::allocator and costs nothing.
+ *
+ */
+namespace alloc_profile {
+
+/* Counters of one tag. */
+struct counter {
+    const char *name;          /* Name of the tag. */
+    counter    *next;          /* Next in registry. */
+    std::atomic <size_t> live; /* Bytes in use. */
+    std::atomic <size_t> peak; /* Max bytes ever in use. */
+    std::atomic <size_t> count;/* Count of allocations. */
+    std::atomic <size_t> freed;/* Count of deallocations. */
+
+    inline counter(const char *__n) noexcept;
+
+    /* Account an allocation of __n bytes. */
+    void allocate(size_t __n) noexcept {
+        count.fetch_add(1,std::memory_order_relaxed);
+        size_t __cur  = live.fetch_add(__n,std::memory_order_relaxed) + __n;
+        size_t __peak = peak.load(std::memory_order_relaxed);
+        while(__peak < __cur && !peak.compare_exchange_weak(
+            __peak,__cur,std::memory_order_relaxed)) {}
+    }
+
+    /* Account a deallocation of __n bytes. */
+    void deallocate(size_t __n) noexcept {
+        freed.fetch_add(1,std::memory_order_relaxed);
+        live.fetch_sub(__n,std::memory_order_relaxed);
+    }
+};
+
+
+/* Guard of the registry. */
+inline std::mutex &registry_lock() { static std::mutex __m; return __m; }
+
+/* Head of all counters ever used , in order of first use. */
+inline counter *&registry() { static counter *__h = nullptr; return __h; }
+
+counter::counter(const char *__n) noexcept
+    : name(__n),next(nullptr),live(0),peak(0),count(0),freed(0) {
+    std::lock_guard <std::mutex> guard(registry_lock());
+    counter **__p = &registry();
+    while(*__p) __p = &(*__p)->next;
+    *__p = this;
+}
+
+/* Counter of given tag. Registered at first use. */
+template <class tag_t>
+counter &of() { static counter __c(tag_t::name); return __c; }
+
+/* Print a table of all tags to __f. Can be called at any time. */
+inline void report(FILE *__f = stderr) {
+    std::lock_guard <std::mutex> guard(registry_lock());
+    size_t __live = 0,__peak = 0;
+    fprintf(__f,"%-16s %14s %14s %12s %12s\n",
+            "tag","live_bytes","peak_bytes","allocs","frees");
+    for(counter *__p = registry() ; __p ; __p = __p->next) {
+        fprintf(__f,"%-16s %14zu %14zu %12zu %12zu\n",__p->name,
+                __p->live.load(),__p->peak.load(),
+                __p->count.load(),__p->freed.load());
+        __live += __p->live.load();
+        __peak += __p->peak.load();
+    }
+    fprintf(__f,"%-16s %14zu %14zu (sum of peaks)\n","total",__live,__peak);
+}
+
+}
+
+
+#ifdef DARK_ALLOC_PROFILE
+
+/**
+ * @brief std::allocator which accounts every allocation to tag_t.
+ *
+ * @tparam T     Value type.
+ * @tparam tag_t Tag with a static name.
+ */
+template <class T,class tag_t>
+struct tagged_allocator : std::allocator <T> {
+    template <class U>
+    struct rebind { using other = tagged_allocator <U,tag_t>; };
+
+    tagged_allocator() noexcept = default;
+    template <class U>
+    tagged_allocator(const tagged_allocator <U,tag_t> &) noexcept {}
+
+    /* Empty blocks are not accounted , for callers may free them as null. */
+    T *allocate(size_t __n) {
+        if(__n) alloc_profile::of <tag_t> ().allocate(__n * sizeof(T));
+        return std::allocator <T>::allocate(__n);
+    }
+
+    void deallocate(T *__p,size_t __n) {
+        if(__n) alloc_profile::of <tag_t> ().deallocate(__n * sizeof(T));
+        std::allocator <T>::deallocate(__p,__n);
+    }
+};
+
+namespace alloc_profile {
+
+/**
+ * Report at exit. Counters are trivially destructible ,
+ * and the registry is constructed here so that it outlives the report.
+ */
+struct exit_reporter {
+    exit_reporter() { registry_lock(); registry(); }
+    ~exit_reporter() {
+        fprintf(stderr,"\n---------- allocation profile ----------\n");
+        report(stderr);
+    }
+};
+
+inline exit_reporter EXIT_REPORTER;
+
+}
+
+#else
+
+/* Profiling disabled: plain std::allocator. */
+template <class T,class tag_t>
+using tagged_allocator = std::allocator <T>;
+
+#endif
+
+}
+
+#endif
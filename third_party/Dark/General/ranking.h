@@ -0,0 +1,150 @@
+#ifndef _DARK_RANKING_H_
+#define _DARK_RANKING_H_
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+namespace dark {
+
+/**
+ * @brief Keep the best k of pushed items , in a buffer of the caller.
+ * The buffer is used as a max-heap on Compare (the worst kept on top),
+ * so an item worse than all k kept ones costs one compare.
+ * Items are kept in place , such as in a return list , and finish()
+ * sorts them there from best to worst without copying out.
+ *
+ * list_t needs data() , size() , clear() , push_back() and operator [].
+ *
+ * @tparam list_t  Type of the buffer.
+ * @tparam Compare Returns whether the first item is better.
+ */
+template <class list_t,class Compare>
+class top_k {
+  public:
+    using value_t = std::remove_reference_t <decltype(std::declval <list_t &> ()[0])>;
+
+  private:
+    list_t &heap;   /* Kept items. */
+    size_t  count;  /* Items to keep. */
+    Compare cmp;
+
+    value_t *begin() { return heap.data(); }
+    value_t *end()   { return heap.data() + heap.size(); }
+
+  public:
+
+    /* Keep the best k items in buf. buf is cleared. */
+    top_k(list_t &buf,size_t k,Compare __c = Compare())
+        : heap(buf),count(k),cmp(__c) { heap.clear(); }
+
+    /* Whether k items are kept. */
+    bool full() const noexcept { return heap.size() >= count; }
+
+    /* Whether x would be kept if pushed now. */
+    bool admits(const value_t &x) { return !full() || (count && cmp(x,heap[0])); }
+
+    /* Push an item. It is dropped if not among the best k. */
+    void push(const value_t &x) {
+        if(!full()) {
+            heap.push_back(x);
+            std::push_heap(begin(),end(),cmp);
+        } else if(count && cmp(x,heap[0])) {
+            std::pop_heap(begin(),end(),cmp);
+            end()[-1] = x;
+            std::push_heap(begin(),end(),cmp);
+        }
+    }
+
+    /* Sort kept items from best to worst. Push no more after it. */
+    void finish() { std::sort_heap(begin(),end(),cmp); }
+};
+
+
+/**
+ * @brief Move the best k of [first,last) to the front , sorted.
+ * It selects in linear time and sorts only the k selected ,
+ * so it is cheaper than a full sort when k is small.
+ *
+ * @return End of the sorted front , first + min(k,last - first).
+ */
+template <class T,class Compare>
+T *sort_top(T *first,T *last,size_t k,Compare cmp) {
+    if(size_t(last - first) > k) {
+        std::nth_element(first,first + k,last,cmp);
+        last = first + k;
+    } std::sort(first,last,cmp);
+    return last;
+}
+
+/* Keep only the best k items of a list , sorted. */
+template <class list_t,class Compare>
+void sort_top(list_t &v,size_t k,Compare cmp)
+{ v.resize(sort_top(v.data(),v.data() + v.size(),k,cmp) - v.data()); }
+
+
+/**
+ * @brief Stable LSD radix sort of [first,last) by an integer key ,
+ * a byte each pass. Counts of all bytes are taken in one pass , and
+ * a byte shared by all keys is skipped , so small keys take few passes.
+ * Being stable , ties keep their order , such as by train id when the
+ * items come from a posting list.
+ *
+ * @param tmp Scratch of at least last - first items.
+ * @param key Called as key(const T &) , returning a signed or unsigned integer.
+ * @return Where the sorted items are , first or tmp.
+ */
+template <class T,class key_func>
+T *radix_sort(T *first,T *last,T *tmp,key_func &&key) {
+    static_assert(std::is_trivially_copyable_v <T>,"Item must be trivially copyable!");
+    using key_t  = std::decay_t <decltype(key(*first))>;
+    static_assert(std::is_integral_v <key_t>,"Key must be an integer!");
+    using uint_t = std::make_unsigned_t <key_t>;
+    constexpr int    kBYTES = sizeof(uint_t);
+    constexpr uint_t kFLIP  = std::is_signed_v <key_t> ? uint_t(uint_t(1) << (kBYTES * 8 - 1)) : 0;
+
+    const size_t __n = last - first;
+    if(!__n) return first;
+    auto bits = [&](const T &x) { return uint_t(key(x)) ^ kFLIP; };
+
+    size_t count[kBYTES][256] = {};
+    for(T *__p = first ; __p != last ; ++__p) {
+        uint_t __k = bits(*__p);
+        for(int i = 0 ; i != kBYTES ; ++i) ++count[i][(__k >> (i * 8)) & 255];
+    }
+
+    T *src = first;
+    T *dst = tmp;
+    for(int i = 0 ; i != kBYTES ; ++i) {
+        size_t *__c = count[i];
+        if(__c[(bits(*src) >> (i * 8)) & 255] == __n) continue;
+        for(size_t j = 0,sum = 0 ; j != 256 ; ++j) {
+            size_t __t = __c[j];
+            __c[j] = sum;
+            sum += __t;
+        }
+        for(T *__p = src ; __p != src + __n ; ++__p)
+            memcpy(dst + __c[(bits(*__p) >> (i * 8)) & 255]++,__p,sizeof(T));
+        std::swap(src,dst);
+    } return src;
+}
+
+/**
+ * @brief Radix sort a list by an integer key , with tmp as scratch.
+ * If the sorted items end up in tmp , the lists are swapped
+ * instead of copied back.
+ */
+template <class list_t,class key_func>
+void radix_sort(list_t &v,list_t &tmp,key_func &&key) {
+    if(v.size() < 2) return;
+    tmp.resize(v.size());
+    auto *__p = radix_sort(v.data(),v.data() + v.size(),tmp.data(),key);
+    if(__p != v.data()) { using std::swap; swap(v,tmp); }
+}
+
+
+}
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef _DARK_THREAD_POOL_H_
+#define _DARK_THREAD_POOL_H_
+
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace dark {
+
+/**
+ * @brief A small work-stealing thread pool.
+ * Every worker owns a deque. It runs its own tasks from the back
+ * (newest first) , and steals from the front of others when idle.
+ * Tasks submitted from outside are spread over the workers.
+ *
+ * Blocking I/O tasks go to a bounded queue served by separate threads,
+ * so they never hold a compute worker. Submitting to a full I/O queue
+ * waits , which throttles the producer.
+ *
+ * Tasks should not throw.
+ */
+class thread_pool {
+  public:
+    using task_t = std::function <void()>;
+
+  private:
+    /* Deque of one worker. */
+    struct worker {
+        std::mutex          lock;
+        std::deque <task_t> tasks;
+    };
+
+    size_t count;                        /* Count of compute workers. */
+    std::unique_ptr <worker[]> workers;  /* Deques of workers. */
+    std::vector <std::thread>  threads;  /* Compute threads. */
+    std::atomic <size_t> pending;        /* Tasks queued and not taken. */
+    std::atomic <size_t> next;           /* Round robin for outside submits. */
+
+    std::mutex              sleep_lock;
+    std::condition_variable sleep_cv;
+    bool                    stopping;
+
+    std::deque <task_t>       io_tasks;    /* Queued I/O tasks. */
+    size_t                    io_capacity; /* Bound of io_tasks. */
+    std::vector <std::thread> io_threads;  /* I/O threads. */
+    std::mutex                io_lock;
+    std::condition_variable   io_not_empty;
+    std::condition_variable   io_not_full;
+
+    inline static thread_local thread_pool *current_pool  = nullptr;
+    inline static thread_local size_t       current_index = 0;
+
+    /* Take a task of worker i from the back. */
+    bool pop(size_t i,task_t &t) {
+        std::lock_guard <std::mutex> guard(workers[i].lock);
+        if(workers[i].tasks.empty()) return false;
+        t = std::move(workers[i].tasks.back());
+        workers[i].tasks.pop_back();
+        return true;
+    }
+
+    /* Take a task of any worker other than i from the front. */
+    bool steal(size_t i,task_t &t) {
+        for(size_t k = 1 ; k <= count ; ++k) {
+            worker &w = workers[(i + k) % count];
+            std::lock_guard <std::mutex> guard(w.lock);
+            if(w.tasks.empty()) continue;
+            t = std::move(w.tasks.front());
+            w.tasks.pop_front();
+            return true;
+        } return false;
+    }
+
+    /* Run one task as worker i. i == count for threads outside. */
+    bool run_one(size_t i) {
+        task_t t;
+        if(!(i != count && pop(i,t)) && !steal(i,t)) return false;
+        pending.fetch_sub(1,std::memory_order_relaxed);
+        t();
+        return true;
+    }
+
+    void work(size_t i) {
+        current_pool  = this;
+        current_index = i;
+        for(;;) {
+            if(run_one(i)) continue;
+            std::unique_lock <std::mutex> guard(sleep_lock);
+            sleep_cv.wait(guard,[this] { return stopping || pending.load(); });
+            if(stopping && !pending.load()) return;
+        }
+    }
+
+    void work_io() {
+        for(;;) {
+            task_t t;
+            {
+                std::unique_lock <std::mutex> guard(io_lock);
+                io_not_empty.wait(guard,[this] { return stopping || !io_tasks.empty(); });
+                if(io_tasks.empty()) return;
+                t = std::move(io_tasks.front());
+                io_tasks.pop_front();
+            }
+            io_not_full.notify_one();
+            t();
+        }
+    }
+
+  public:
+
+    /**
+     * @brief Start the workers.
+     *
+     * @param __n   Count of compute workers. 0 for hardware concurrency.
+     * @param __io  Count of I/O threads.
+     * @param __cap Bound of the I/O queue.
+     */
+    explicit thread_pool(size_t __n = 0,size_t __io = 2,size_t __cap = 64) :
+        count(__n ? __n : std::max(1u,std::thread::hardware_concurrency())),
+        workers(new worker[count]),pending(0),next(0),stopping(false),
+        io_capacity(__cap ? __cap : 1) {
+        threads.reserve(count);
+        for(size_t i = 0 ; i != count ; ++i) threads.emplace_back([this,i] { work(i); });
+        io_threads.reserve(__io);
+        for(size_t i = 0 ; i != __io ; ++i) io_threads.emplace_back([this] { work_io(); });
+    }
+
+    thread_pool(const thread_pool &) = delete;
+
+    /* Finish all queued tasks and stop. */
+    ~thread_pool() {
+        { std::scoped_lock guard(sleep_lock,io_lock); stopping = true; }
+        sleep_cv.notify_all();
+        io_not_empty.notify_all();
+        for(auto &t : threads)    t.join();
+        for(auto &t : io_threads) t.join();
+    }
+
+    /* Pool shared by the whole process , sized to the hardware. */
+    static thread_pool &global() { static thread_pool pool; return pool; }
+
+    /* Count of compute workers. */
+    size_t size() const noexcept { return count; }
+
+    /* Submit a compute task. A worker pushes to its own deque. */
+    void submit(task_t t) {
+        size_t i = current_pool == this ? current_index
+                 : next.fetch_add(1,std::memory_order_relaxed) % count;
+        {
+            std::lock_guard <std::mutex> guard(workers[i].lock);
+            workers[i].tasks.push_back(std::move(t));
+        }
+        pending.fetch_add(1,std::memory_order_relaxed);
+        { std::lock_guard <std::mutex> guard(sleep_lock); }
+        sleep_cv.notify_one();
+    }
+
+    /* Submit an I/O task. Wait while the I/O queue is full. */
+    void submit_io(task_t t) {
+        {
+            std::unique_lock <std::mutex> guard(io_lock);
+            io_not_full.wait(guard,[this] { return io_tasks.size() < io_capacity; });
+            io_tasks.push_back(std::move(t));
+        }
+        io_not_empty.notify_one();
+    }
+
+    /* Run one queued compute task on this thread. Return whether any. */
+    bool help() { return run_one(current_pool == this ? current_index : count); }
+
+    /* Group of tasks that can be joined. */
+    class task_group {
+      private:
+        thread_pool &pool;
+        std::atomic <size_t> left; /* Tasks not finished. */
+
+      public:
+
+        explicit task_group(thread_pool &__p = thread_pool::global()) : pool(__p),left(0) {}
+        task_group(const task_group &) = delete;
+        ~task_group() { wait(); }
+
+        /* Run a compute task in the group. */
+        template <class func_t>
+        void run(func_t &&__f) {
+            left.fetch_add(1,std::memory_order_relaxed);
+            pool.submit([this,__f = std::forward <func_t> (__f)]() mutable {
+                __f(); left.fetch_sub(1,std::memory_order_release);
+            });
+        }
+
+        /* Run an I/O task in the group. */
+        template <class func_t>
+        void run_io(func_t &&__f) {
+            left.fetch_add(1,std::memory_order_relaxed);
+            pool.submit_io([this,__f = std::forward <func_t> (__f)]() mutable {
+                __f(); left.fetch_sub(1,std::memory_order_release);
+            });
+        }
+
+        /* Wait for all tasks , running queued tasks meanwhile. */
+        void wait() {
+            while(left.load(std::memory_order_acquire))
+                if(!pool.help()) std::this_thread::yield();
+        }
+    };
+
+    /**
+     * @brief Run func(lo,hi) over chunks of [first,last) in parallel.
+     * The calling thread runs the last chunk and joins the others.
+     *
+     * @param first First index.
+     * @param last  One past the last index.
+     * @param func  Called with each chunk [lo,hi).
+     * @param grain Size of a chunk. 0 for about 4 chunks per worker.
+     */
+    template <class func_t>
+    void parallel_for(size_t first,size_t last,func_t &&func,size_t grain = 0) {
+        if(first >= last) return;
+        size_t __n = last - first;
+        if(!grain) grain = std::max <size_t> (1,__n / (count * 4));
+        task_group group(*this);
+        size_t lo = first;
+        for(; last - lo > grain ; lo += grain)
+            group.run([&func,lo,grain] { func(lo,lo + grain); });
+        func(lo,last);
+        group.wait();
+    }
+};
+
+
+}
+
+#endif